@@ -0,0 +1,427 @@
+﻿/*
+========================================
+【IconInverter 基准测试】
+========================================
+
+覆盖的热点：
+1. rgbToHsl / hslToRgb 单像素颜色空间转换
+2. invertBrightness 在不同图像尺寸、不同反转实现下的吞吐
+3. invertColorString 与 SVG 颜色缓存在颜色字符串语料上的吞吐
+4. SVG（DOM / 流式）在不同嵌套深度的合成 SVG 上的耗时，文件到文件与纯内存各一组
+5. 多条目 ICO（BMP + PNG）的文件到文件处理与纯内存 invert()
+
+所有测试数据由内置生成器按固定种子合成，不依赖外部文件，可离线运行。
+
+用法: IconInverterBenchmark [--filter 子串] [--min-time 秒] [--repeats N] [--fixtures 目录]
+  --filter     只运行名称包含该子串的用例
+  --min-time   每轮测量的最短时间（默认 0.2 秒）
+  --repeats    测量轮数，报告中位数（默认 5）
+  --fixtures   把合成的 SVG / ICO 写到指定目录并保留（默认写入临时目录，结束后删除）
+*/
+
+#include "../Project2/iconinverter_detail.h"
+#include "../Project2/minipng.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace iconinv;
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+// 用例把运行结果折算成校验值写入这里，防止被优化掉
+static volatile uint64_t g_sink = 0;
+
+struct Case {
+    std::string name;
+    double bytesPerIter = 0;  // 每次迭代处理的字节数（0 表示不报告带宽）
+    double itemsPerIter = 0;  // 每次迭代处理的条目数（0 表示不报告条目速率）
+    std::function<uint64_t(size_t)> run; // 执行 n 次迭代，返回校验值
+};
+
+struct Options {
+    std::string filter;
+    double minTime = 0.2;
+    int repeats = 5;
+    fs::path fixtureDir;
+    bool keepFixtures = false;
+};
+
+static double secondsOf(const std::function<uint64_t(size_t)>& run, size_t iters) {
+    auto start = Clock::now();
+    g_sink = g_sink + run(iters);
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static std::string formatTime(double ns) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(ns < 10 ? 2 : 1);
+    if (ns < 1e3) os << ns << " ns";
+    else if (ns < 1e6) os << ns / 1e3 << " us";
+    else if (ns < 1e9) os << ns / 1e6 << " ms";
+    else os << ns / 1e9 << " s";
+    return os.str();
+}
+
+static std::string formatRate(double perSecond, const char* unit) {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(1);
+    if (perSecond >= 1e9) os << perSecond / 1e9 << " G" << unit;
+    else if (perSecond >= 1e6) os << perSecond / 1e6 << " M" << unit;
+    else if (perSecond >= 1e3) os << perSecond / 1e3 << " K" << unit;
+    else os << perSecond << " " << unit;
+    return os.str();
+}
+
+// 先按 10 倍递增找出量级，再把迭代次数定到约 minTime 秒，测 repeats 轮取中位数
+static void runCase(const Case& c, const Options& opts) {
+    size_t iters = 1;
+    double t = secondsOf(c.run, iters);
+    while (t < opts.minTime / 10 && iters < (size_t(1) << 40)) {
+        iters *= 10;
+        t = secondsOf(c.run, iters);
+    }
+    iters = std::max<size_t>(1, static_cast<size_t>(iters * (opts.minTime / std::max(t, 1e-9))));
+    std::vector<double> perIter;
+    for (int r = 0; r < opts.repeats; ++r) perIter.push_back(secondsOf(c.run, iters) / iters);
+    std::sort(perIter.begin(), perIter.end());
+    double median = perIter[perIter.size() / 2];
+
+    std::cout << std::left << std::setw(44) << c.name << std::right << std::setw(12) << formatTime(median * 1e9)
+        << std::setw(14) << (c.bytesPerIter > 0 ? formatRate(c.bytesPerIter / median, "B/s") : "-")
+        << std::setw(14) << (c.itemsPerIter > 0 ? formatRate(c.itemsPerIter / median, "/s") : "-")
+        << std::setw(12) << iters << "\n";
+}
+
+// ------------------- 合成数据 --------------------------
+
+static std::mt19937& rng() {
+    static std::mt19937 gen(20240601u);
+    return gen;
+}
+
+static std::vector<RGB> randomColors(size_t n) {
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<RGB> colors(n);
+    for (auto& c : colors) c = RGB{ uint8_t(byte(rng())), uint8_t(byte(rng())), uint8_t(byte(rng())), 255 };
+    return colors;
+}
+
+// 图标常见的内容：大面积纯色 + 渐变 + 少量噪声；16 位图像取同样的内容 × 257。
+// monochrome 时 B、G、R 取相同的值（单色图标）
+template <typename T>
+static void fillImage(cv::Mat& img, int channels, bool monochrome) {
+    const int scale = sizeof(T) == 2 ? 257 : 1;
+    std::uniform_int_distribution<int> noise(0, 15);
+    for (int y = 0; y < img.rows; ++y) {
+        T* row = img.ptr<T>(y);
+        for (int x = 0; x < img.cols; ++x) {
+            T* px = row + size_t(x) * channels;
+            int v[4] = { x * 255 / std::max(1, img.cols - 1), y * 255 / std::max(1, img.rows - 1),
+                ((x / 8 + y / 8) & 1) ? 200 : 40 + noise(rng()), (x + y) % 7 == 0 ? 0 : 255 };
+            for (int k = 0; k < channels; ++k) px[k] = T(v[channels == 1 || (monochrome && k < 3) ? 2 : k] * scale);
+        }
+    }
+}
+
+static cv::Mat randomImage(int width, int height, int channels, int depth = CV_8U, bool monochrome = false) {
+    cv::Mat img(height, width, CV_MAKETYPE(depth, channels));
+    if (depth == CV_16U) fillImage<uint16_t>(img, channels, monochrome);
+    else fillImage<uint8_t>(img, channels, monochrome);
+    return img;
+}
+
+// 颜色字符串语料：按 SVG 里实际出现的比例混合各种写法
+static std::vector<std::string> colorCorpus(size_t n) {
+    static const char* named[] = { "red", "White", "navy", "rebeccapurple", "lightgoldenrodyellow", "Gray", "teal", "orange" };
+    static const char* other[] = { "none", "url(#grad1)", "currentColor", "transparent", "#12345", "rgb(1,2)" };
+    std::uniform_int_distribution<int> pick(0, 99), byte(0, 255);
+    std::vector<std::string> corpus;
+    corpus.reserve(n);
+    char buf[64];
+    for (size_t i = 0; i < n; ++i) {
+        int k = pick(rng());
+        int r = byte(rng()), g = byte(rng()), b = byte(rng());
+        if (k < 40) std::snprintf(buf, sizeof(buf), "#%02x%02x%02x", r, g, b);
+        else if (k < 55) std::snprintf(buf, sizeof(buf), "#%X%X%X", r >> 4, g >> 4, b >> 4);
+        else if (k < 70) std::snprintf(buf, sizeof(buf), "rgb(%d, %d, %d)", r, g, b);
+        else if (k < 75) std::snprintf(buf, sizeof(buf), "rgba(%d%%,%d%%,%d%%,0.5)", r * 100 / 255, g * 100 / 255, b * 100 / 255);
+        else if (k < 90) std::snprintf(buf, sizeof(buf), "%s", named[size_t(k) % std::size(named)]);
+        else std::snprintf(buf, sizeof(buf), "%s", other[size_t(k) % std::size(other)]);
+        corpus.emplace_back(buf);
+    }
+    return corpus;
+}
+
+// 嵌套 depth 层 <g>，每层挂 leaves 个带 fill / stroke / style 的图元
+static std::string makeSvg(int depth, int leaves) {
+    std::vector<std::string> colors = colorCorpus(size_t(depth) * (size_t(leaves) * 3 + 1));
+    size_t next = 0;
+    std::string svg = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"64\" height=\"64\" viewBox=\"0 0 64 64\">\n";
+    for (int d = 0; d < depth; ++d) {
+        svg += std::string(size_t(d) + 1, ' ') + "<g fill=\"" + colors[next++] + "\">\n";
+        for (int l = 0; l < leaves; ++l, next += 3) {
+            svg += std::string(size_t(d) + 2, ' ') + "<path d=\"M" + std::to_string(l) + " 0L64 " + std::to_string(d) +
+                "Z\" fill=\"" + colors[next] + "\" stroke=\"" + colors[next + 1] +
+                "\" style=\"opacity:0.8;stop-color:" + colors[next + 2] + "\"/>\n";
+        }
+    }
+    for (int d = depth - 1; d >= 0; --d) svg += std::string(size_t(d) + 1, ' ') + "</g>\n";
+    svg += "</svg>\n";
+    return svg;
+}
+
+static void appendLe(std::vector<uint8_t>& out, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(uint8_t(v >> (8 * i)));
+}
+
+// 多条目 ICO：每个尺寸一条 32 位 BMP（含 AND 掩码），pngSizes 中的尺寸用 PNG 存储
+static std::vector<uint8_t> makeIco(const std::vector<int>& bmpSizes, const std::vector<int>& pngSizes) {
+    std::vector<std::vector<uint8_t>> images;
+    std::vector<int> sizes;
+    for (int s : bmpSizes) {
+        cv::Mat img = randomImage(s, s, 4);
+        std::vector<uint8_t> dib;
+        appendLe(dib, 40, 4);
+        appendLe(dib, uint32_t(s), 4);
+        appendLe(dib, uint32_t(s * 2), 4);
+        appendLe(dib, 1, 2);
+        appendLe(dib, 32, 2);
+        for (int i = 0; i < 6; ++i) appendLe(dib, 0, 4);
+        for (int y = s - 1; y >= 0; --y) dib.insert(dib.end(), img.ptr<uint8_t>(y), img.ptr<uint8_t>(y) + size_t(s) * 4);
+        dib.resize(dib.size() + size_t((s + 31) / 32) * 4 * s, 0);
+        images.push_back(std::move(dib));
+        sizes.push_back(s);
+    }
+    for (int s : pngSizes) {
+        cv::Mat img = randomImage(s, s, 4);
+        std::vector<uint8_t> png;
+        minipng::Scratch scratch;
+        // 编码失败时 PNG 条目为空或残缺，ICO 用例测到的会是兜底 / 报错路径，整体中止
+        if (!minipng::encodeRgba8(img.ptr<uint8_t>(0), uint32_t(s), uint32_t(s), minipng::kDefaultLevel, png, scratch))
+            throw std::runtime_error("minipng 编码 " + std::to_string(s) + "x" + std::to_string(s) + " 的 PNG 条目失败");
+        images.push_back(std::move(png));
+        sizes.push_back(s);
+    }
+    std::vector<uint8_t> ico;
+    appendLe(ico, 0, 2);
+    appendLe(ico, 1, 2);
+    appendLe(ico, uint32_t(images.size()), 2);
+    size_t offset = 6 + 16 * images.size();
+    for (size_t i = 0; i < images.size(); ++i) {
+        ico.push_back(uint8_t(sizes[i] >= 256 ? 0 : sizes[i]));
+        ico.push_back(uint8_t(sizes[i] >= 256 ? 0 : sizes[i]));
+        ico.push_back(0);
+        ico.push_back(0);
+        appendLe(ico, 1, 2);
+        appendLe(ico, 32, 2);
+        appendLe(ico, uint32_t(images[i].size()), 4);
+        appendLe(ico, uint32_t(offset), 4);
+        offset += images[i].size();
+    }
+    for (const auto& img : images) ico.insert(ico.end(), img.begin(), img.end());
+    return ico;
+}
+
+static void writeFixture(const fs::path& path, const void* data, size_t size) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+// ------------------- 用例 --------------------------
+
+static std::vector<Case> buildCases(const Options& opts) {
+    std::vector<Case> cases;
+
+    // 1. 颜色空间转换
+    {
+        auto colors = std::make_shared<std::vector<RGB>>(randomColors(4096));
+        auto hsls = std::make_shared<std::vector<HSL>>();
+        for (const RGB& c : *colors) hsls->push_back(rgbToHsl(c));
+        cases.push_back({ "rgbToHsl/4096", 0, 4096.0, [colors](size_t n) {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; ++i)
+                for (const RGB& c : *colors) sum += static_cast<uint64_t>(rgbToHsl(c).l * 1000);
+            return sum;
+            } });
+        cases.push_back({ "hslToRgb/4096", 0, 4096.0, [hsls](size_t n) {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n; ++i)
+                for (const HSL& h : *hsls) sum += hslToRgb(h).g;
+            return sum;
+            } });
+    }
+
+    // 2. 整图亮度反转：默认实现下的尺寸曲线 + 固定尺寸下各实现对比
+    auto addInvert = [&](int size, int channels, std::optional<InversionMode> mode, const char* modeName,
+        int depth = CV_8U, bool monochrome = false) {
+        auto img = std::make_shared<cv::Mat>(randomImage(size, size, channels, depth, monochrome));
+        std::string name = "invertBrightness/" + std::to_string(size) + "x" + std::to_string(size) + "x" + std::to_string(channels);
+        if (depth == CV_16U) name += "/16u";
+        if (monochrome) name += "/mono";
+        if (mode) name += std::string("/") + modeName;
+        cases.push_back({ name, double(size) * size * img->elemSize(), double(size) * size, [img, mode](size_t n) {
+            InversionMode saved = inversionMode();
+            if (mode) setInversionMode(*mode);
+            for (size_t i = 0; i < n; ++i) invertBrightness(*img);
+            setInversionMode(saved);
+            return uint64_t(img->ptr<uint8_t>(0)[0]);
+            } });
+        };
+    for (int size : { 16, 32, 64, 256, 1024, 2048 }) addInvert(size, 3, std::nullopt, "");
+    addInvert(256, 4, std::nullopt, "");
+    addInvert(256, 1, std::nullopt, "");
+    addInvert(256, 4, std::nullopt, "", CV_8U, true);
+    addInvert(256, 3, std::nullopt, "", CV_16U);
+    addInvert(256, 4, std::nullopt, "", CV_16U);
+    const std::pair<InversionMode, const char*> modes[] = {
+        { InversionMode::Exact, "exact" }, { InversionMode::Simd, "simd" },
+        { InversionMode::Lut, "lut" }, { InversionMode::Compact, "compact" },
+        { InversionMode::Integer, "integer" } };
+    for (const auto& [mode, modeName] : modes) addInvert(1024, 3, mode, modeName);
+
+    // 3. 颜色字符串
+    {
+        auto corpus = std::make_shared<std::vector<std::string>>(colorCorpus(1024));
+        double bytes = 0;
+        for (const auto& s : *corpus) bytes += double(s.size());
+        cases.push_back({ "invertColorString/corpus1024", bytes, 1024.0, [corpus](size_t n) {
+            uint64_t sum = 0;
+            char hex[8];
+            for (size_t i = 0; i < n; ++i)
+                for (const auto& s : *corpus) sum += invertColorString(s, hex) ? uint8_t(hex[1]) : 0;
+            return sum;
+            } });
+        cases.push_back({ "ColorInversionCache/corpus1024", bytes, 1024.0, [corpus](size_t n) {
+            uint64_t sum = 0;
+            char hex[8];
+            ColorInversionCache& cache = ColorInversionCache::local();
+            for (size_t i = 0; i < n; ++i)
+                for (const auto& s : *corpus) sum += cache.invert(s, hex) ? uint8_t(hex[1]) : 0;
+            cache.flushStats();
+            return sum;
+            } });
+    }
+
+    // 4. SVG：文件到文件（含磁盘读写）与纯内存，DOM 与流式各一组
+    for (int depth : { 4, 16, 64 }) {
+        auto svg = std::make_shared<std::string>(makeSvg(depth, 8));
+        fs::path input = opts.fixtureDir / ("svg_depth" + std::to_string(depth) + ".svg");
+        fs::path output = opts.fixtureDir / "out" / input.filename();
+        writeFixture(input, svg->data(), svg->size());
+        for (SvgMode mode : { SvgMode::Dom, SvgMode::Stream }) {
+            std::string name = "svg/depth" + std::to_string(depth) + (mode == SvgMode::Dom ? "/dom" : "/stream");
+            cases.push_back({ name + "/file", double(svg->size()), 1.0, [input, output, mode](size_t n) {
+                SvgMode saved = svgMode();
+                setSvgMode(mode);
+                for (size_t i = 0; i < n; ++i) processFile(input, output);
+                setSvgMode(saved);
+                return uint64_t(fs::file_size(output));
+                } });
+            cases.push_back({ name + "/memory", double(svg->size()), 1.0, [svg, mode](size_t n) {
+                SvgMode saved = svgMode();
+                setSvgMode(mode);
+                OutputBuffer out;
+                uint64_t sum = 0;
+                for (size_t i = 0; i < n; ++i) sum += invert(asBytes(*svg), Format::Svg, out) ? out.size() : 0;
+                setSvgMode(saved);
+                return sum;
+                } });
+        }
+    }
+
+    // 5. ICO：文件到文件（载入 / 处理 / 保存整个流程），以及不含磁盘读写的内存版本
+    struct IcoFixture { const char* name; std::vector<int> bmp, png; };
+    const IcoFixture icoFixtures[] = {
+        { "bmp6", { 16, 24, 32, 48, 64, 128 }, {} },
+        { "bmp6+png256", { 16, 24, 32, 48, 64, 128 }, { 256 } },
+        { "png4", {}, { 32, 64, 128, 256 } },
+    };
+    for (const IcoFixture& f : icoFixtures) {
+        auto ico = std::make_shared<std::vector<uint8_t>>(makeIco(f.bmp, f.png));
+        fs::path input = opts.fixtureDir / (std::string(f.name) + ".ico");
+        fs::path output = opts.fixtureDir / "out" / input.filename();
+        writeFixture(input, ico->data(), ico->size());
+        cases.push_back({ std::string("ico/") + f.name + "/file", double(ico->size()), 1.0, [input, output](size_t n) {
+            for (size_t i = 0; i < n; ++i) processFile(input, output);
+            return uint64_t(fs::file_size(output));
+            } });
+        for (IcoPngCodec codec : { IcoPngCodec::Builtin, IcoPngCodec::OpenCV }) {
+            if (f.png.empty() && codec == IcoPngCodec::OpenCV) continue; // 纯 BMP 与编解码方式无关
+            std::string name = std::string("ico/") + f.name + "/memory" + (f.png.empty() ? "" : codec == IcoPngCodec::Builtin ? "/builtin" : "/opencv");
+            cases.push_back({ name, double(ico->size()), 1.0, [ico, codec](size_t n) {
+                IcoPngCodec saved = icoPngCodec();
+                setIcoPngCodec(codec);
+                OutputBuffer out;
+                uint64_t sum = 0;
+                for (size_t i = 0; i < n; ++i) sum += invert(*ico, Format::Ico, out) ? out.size() : 0;
+                setIcoPngCodec(saved);
+                return sum;
+                } });
+        }
+    }
+    return cases;
+}
+
+} // namespace bench
+
+int main(int argc, char* argv[]) {
+    bench::Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--filter" && i + 1 < argc) opts.filter = argv[++i];
+            else if (arg == "--min-time" && i + 1 < argc) opts.minTime = std::stod(argv[++i]);
+            else if (arg == "--repeats" && i + 1 < argc) opts.repeats = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--fixtures" && i + 1 < argc) { opts.fixtureDir = argv[++i]; opts.keepFixtures = true; }
+            else {
+                std::cerr << "用法: IconInverterBenchmark [--filter 子串] [--min-time 秒] [--repeats N] [--fixtures 目录]\n";
+                return 1;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "参数无效: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (opts.fixtureDir.empty()) opts.fixtureDir = fs::temp_directory_path() / "iconinverter-bench";
+    fs::create_directories(opts.fixtureDir / "out");
+
+    std::cout << "IconInverter 基准测试\nSIMD: " << simdLevelName(simdLevel())
+        << "，硬件线程: " << std::thread::hardware_concurrency() << "\n\n";
+    std::cout << std::left << std::setw(44) << "用例" << std::right << std::setw(12) << "每次" << std::setw(14) << "带宽"
+        << std::setw(14) << "条目速率" << std::setw(12) << "迭代数" << "\n";
+
+    std::vector<bench::Case> cases;
+    try {
+        cases = bench::buildCases(opts);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "样本生成失败: " << e.what() << "\n";
+        return 1;
+    }
+    for (const bench::Case& c : cases) {
+        if (!opts.filter.empty() && c.name.find(opts.filter) == std::string::npos) continue;
+        bench::runCase(c, opts);
+    }
+
+    if (!opts.keepFixtures) {
+        std::error_code ec;
+        fs::remove_all(opts.fixtureDir, ec);
+    }
+    return 0;
+}
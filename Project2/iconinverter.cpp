@@ -0,0 +1,3276 @@
+﻿/*
+========================================
+【IconInverter 核心库实现】
+========================================
+
+接口见 iconinverter.h；命令行工具（main.cpp）只负责解析参数并调用 batchProcess()。
+SVG 使用 TinyXML2，JPEG / PNG / BMP 与兜底解码使用 OpenCV，ICO 内嵌 PNG 默认走 minipng。
+*/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <filesystem>
+#include <climits>
+#include <cerrno>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOGDI
+#define NOGDI // wingdi.h 的 RGB 宏会与下面的 struct RGB 冲突
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <linux/fs.h>   // FICLONE
+#elif defined(__APPLE__)
+#include <sys/clonefile.h>
+#endif
+#endif
+#include <opencv2/opencv.hpp>
+#include "tinyxml2.h"
+#include "minipng.h"
+#include "iconinverter.h"
+#include "iconinverter_detail.h"
+#include <mutex>
+#include <atomic>
+#include <sstream>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <set>
+#include <tuple>
+#include <optional>
+#include <chrono>
+#include <random>
+#include <regex>
+#include <utility>
+#include <memory>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define ICONINV_X86 1
+#define ICONINV_TARGET(isa)
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ICONINV_X86 1
+#define ICONINV_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace fs = std::filesystem;
+using namespace tinyxml2;
+
+namespace iconinv {
+
+// ------------------- 线程安全的控制台输出 --------------------------
+// 并行批处理时，链式 operator<< 之间可能被其他线程插入导致半行交错；
+// LogLine 先在本地拼好整条消息，析构时持锁一次性写出。用法：LogLine(std::cerr) << "..." << x << "\n";
+static std::mutex g_consoleMutex;
+
+class LogLine {
+public:
+    explicit LogLine(std::ostream& os) : os_(os) {}
+    ~LogLine() {
+        std::lock_guard<std::mutex> lock(g_consoleMutex);
+        os_ << buf_.str();
+    }
+    template <typename T>
+    LogLine& operator<<(const T& v) { buf_ << v; return *this; }
+    LogLine& operator<<(std::ostream& (*manip)(std::ostream&)) { buf_ << manip; return *this; }
+private:
+    std::ostream& os_;
+    std::ostringstream buf_;
+};
+
+// ------------------- 输入文件映射 --------------------------
+// ICO / SVG / 位图的读取统一走 MappedFile：大文件直接 mmap（Windows 下 MapViewOfFile），
+// 读取方按需缺页，不再经过 ifstream 缓冲与 vector 的二次拷贝；
+// 小文件（< kMinMapSize）和管道等非普通文件退回一次性 read() 到自有缓冲。
+// allowMap = false 时一律读入自有缓冲：流水线的读入线程要在本线程把数据真正读完，
+// 映射会把读盘推迟到计算线程的缺页上。
+class MappedFile {
+public:
+    static constexpr size_t kMinMapSize = 64 * 1024;
+    static constexpr size_t kReadChunk = 64 * 1024; // 大小未知（管道等）时缓冲的初始大小与增量下限
+
+    MappedFile() = default;
+    explicit MappedFile(const fs::path& path, bool allowMap = true) { open(path, allowMap); }
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const fs::path& path, bool allowMap = true);
+    void close();
+
+    bool isOpen() const { return open_; }
+    const uint8_t* data() const { return mapped_ ? mapped_ : owned_.data(); }
+    size_t size() const { return size_; }
+    std::string_view view() const { return { reinterpret_cast<const char*>(data()), size_ }; }
+
+    // 包一层不拷贝的 cv::Mat 头，供 cv::imdecode 直接解码
+    cv::Mat asMat() const {
+        if (size_ == 0 || size_ > static_cast<size_t>(INT_MAX)) return cv::Mat();
+        return cv::Mat(1, static_cast<int>(size_), CV_8UC1, const_cast<uint8_t*>(data()));
+    }
+
+private:
+    const uint8_t* mapped_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+    std::vector<uint8_t> owned_;
+};
+
+#if defined(_WIN32)
+bool MappedFile::open(const fs::path& path, bool allowMap) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize{};
+    bool regular = GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize);
+    if (allowMap && regular && static_cast<uint64_t>(fileSize.QuadPart) >= kMinMapSize) {
+        HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            mapped_ = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping); // 视图会保持映射对象存活
+        }
+        if (mapped_) {
+            size_ = static_cast<size_t>(fileSize.QuadPart);
+            CloseHandle(file);
+            return open_ = true;
+        }
+    }
+    // 小文件 / 管道 / 映射失败：直接读进自有缓冲（普通文件按大小一次分配好，其余按需倍增），
+    // 不经栈上的中转块；读出错不当作文件结束，整体失败
+    owned_.resize(regular ? static_cast<size_t>(fileSize.QuadPart) : kReadChunk);
+    size_t used = 0;
+    for (;;) {
+        if (used == owned_.size()) {
+            // 普通文件读满即止；大小报为 0 的（如 /proc 下的文件）与管道一样按需扩大
+            if (regular && used > 0) break;
+            owned_.resize(used + std::max(used, kReadChunk));
+        }
+        DWORD want = static_cast<DWORD>(std::min<size_t>(owned_.size() - used, 1u << 30));
+        DWORD got = 0;
+        if (!ReadFile(file, owned_.data() + used, want, &got, nullptr)) {
+            // 管道写端关闭属于正常结束
+            if (GetLastError() == ERROR_BROKEN_PIPE) break;
+            CloseHandle(file);
+            owned_.clear();
+            return false;
+        }
+        if (got == 0) break;
+        used += got;
+    }
+    CloseHandle(file);
+    owned_.resize(used);
+    size_ = used;
+    return open_ = true;
+}
+
+void MappedFile::close() {
+    if (mapped_) UnmapViewOfFile(mapped_);
+    mapped_ = nullptr;
+    owned_.clear();
+    size_ = 0;
+    open_ = false;
+}
+#else
+bool MappedFile::open(const fs::path& path, bool allowMap) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st {};
+    bool regular = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (allowMap && regular && static_cast<size_t>(st.st_size) >= kMinMapSize) {
+        void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            mapped_ = static_cast<const uint8_t*>(p);
+            size_ = static_cast<size_t>(st.st_size);
+            ::close(fd);
+            return open_ = true;
+        }
+    }
+    // 小文件 / 管道 / 映射失败：直接读进自有缓冲（普通文件按大小一次分配好，其余按需倍增），
+    // 不经栈上的中转块；读出错不当作文件结束，整体失败
+    owned_.resize(regular ? static_cast<size_t>(st.st_size) : kReadChunk);
+    size_t used = 0;
+    for (;;) {
+        if (used == owned_.size()) {
+            // 普通文件读满即止；大小报为 0 的（如 /proc 下的文件）与管道一样按需扩大
+            if (regular && used > 0) break;
+            owned_.resize(used + std::max(used, kReadChunk));
+        }
+        ssize_t got = ::read(fd, owned_.data() + used, owned_.size() - used);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) {
+            ::close(fd);
+            owned_.clear();
+            return false;
+        }
+        if (got == 0) break;
+        used += static_cast<size_t>(got);
+    }
+    ::close(fd);
+    owned_.resize(used);
+    size_ = used;
+    return open_ = true;
+}
+
+void MappedFile::close() {
+    if (mapped_) ::munmap(const_cast<uint8_t*>(mapped_), size_);
+    mapped_ = nullptr;
+    owned_.clear();
+    size_ = 0;
+    open_ = false;
+}
+#endif
+
+// 整块写出文件，父目录不存在时先创建。
+// 先写同目录的临时文件再改名覆盖：旧输出若是去重留下的硬链接 / reflink，
+// 原地截断会连带改写共享数据的其他副本；改名只替换目录项。中途失败也不会留下半截输出
+static bool writeFileBytes(const fs::path& path, const uint8_t* data, size_t size) {
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    fs::path tmp = path;
+    tmp += ".iconinverter-tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+        if (!file) {
+            file.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+// ------------------- 阶段计时与计数 --------------------------
+
+// 单个文件依次经过的阶段。批处理结束时按阶段汇总各线程的累计耗时，
+// 用来判断慢在磁盘、解码、XML 解析、反转还是编码
+enum class Stage { Read, Decode, XmlParse, Invert, Encode, Write, Count };
+
+struct StageInfo { const char* key; const char* label; };
+static const StageInfo kStageInfo[] = {
+    { "read", "读入" },
+    { "decode", "解码" },
+    { "xml_parse", "XML 解析" },
+    { "invert", "反转" },
+    { "encode", "编码/打包" },
+    { "write", "写出" },
+};
+static_assert(std::size(kStageInfo) == static_cast<size_t>(Stage::Count), "kStageInfo 与 Stage 不一致");
+
+struct StageStat {
+    std::atomic<uint64_t> count{ 0 }, nanos{ 0 };
+};
+
+static StageStat g_stageStats[static_cast<int>(Stage::Count)];
+
+static inline uint64_t nanosSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+static inline void addStageNanos(Stage stage, uint64_t nanos) {
+    StageStat& st = g_stageStats[static_cast<int>(stage)];
+    st.count.fetch_add(1, std::memory_order_relaxed);
+    st.nanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+// 作用域计时：构造时开始，析构或提前 stop() 时记入对应阶段
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage) : stage_(stage), start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() { stop(); }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+    void stop() {
+        if (stopped_) return;
+        stopped_ = true;
+        addStageNanos(stage_, nanosSince(start_));
+    }
+private:
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+    bool stopped_ = false;
+};
+
+// 按输入格式统计文件数、字节数与单文件耗时（读入到写出）。
+// 每个文件只在结束时加锁记一次，耗时样本全部保留，分位数是精确值
+struct FormatStat {
+    uint64_t files = 0, failed = 0, inputBytes = 0, outputBytes = 0, nanos = 0;
+    std::vector<uint64_t> latencies;
+};
+
+static std::mutex g_formatStatsMutex;
+static FormatStat g_formatStats[kFormatCount];
+
+static void recordFileStat(Format format, size_t inputBytes, size_t outputBytes, uint64_t nanos, bool ok) {
+    std::lock_guard<std::mutex> lock(g_formatStatsMutex);
+    FormatStat& st = g_formatStats[static_cast<int>(format)];
+    st.files += 1;
+    if (!ok) st.failed += 1;
+    st.inputBytes += inputBytes;
+    st.outputBytes += outputBytes;
+    st.nanos += nanos;
+    st.latencies.push_back(nanos);
+}
+
+// 最近秩法分位数；sorted 须已升序
+static double percentileMs(const std::vector<uint64_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1] / 1e6;
+}
+
+// 打印阶段与格式汇总，jsonPath 非空时另写一份 JSON 报告，然后清零全部统计。
+// 各格式的“个/s”“字节/s”按该格式的累计处理时间计算（即单线程吞吐，与并行度无关），
+// 整体吞吐按批处理的墙钟时间计算
+static void reportBatchStats(double wallSeconds, const std::string& jsonPath) {
+    uint64_t stageCount[static_cast<int>(Stage::Count)], stageNanos[static_cast<int>(Stage::Count)];
+    uint64_t stageTotal = 0;
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        stageCount[i] = g_stageStats[i].count.exchange(0);
+        stageNanos[i] = g_stageStats[i].nanos.exchange(0);
+        stageTotal += stageNanos[i];
+    }
+    FormatStat formats[kFormatCount];
+    {
+        std::lock_guard<std::mutex> lock(g_formatStatsMutex);
+        for (size_t i = 0; i < kFormatCount; ++i) formats[i] = std::exchange(g_formatStats[i], FormatStat{});
+    }
+    uint64_t totalFiles = 0;
+    for (FormatStat& st : formats) {
+        std::sort(st.latencies.begin(), st.latencies.end());
+        totalFiles += st.files;
+    }
+
+    if (stageTotal > 0) {
+        LogLine line(std::cout);
+        line << "\n[阶段耗时]（各线程累计）\n";
+        for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+            if (stageCount[i] == 0) continue;
+            double ms = stageNanos[i] / 1e6;
+            line << "  " << kStageInfo[i].label << ": " << stageCount[i] << " 次，共 " << ms << " ms，平均 "
+                << ms / stageCount[i] << " ms，占 " << (stageNanos[i] * 1000 / stageTotal) / 10.0 << "%\n";
+        }
+    }
+    if (totalFiles > 0) {
+        LogLine line(std::cout);
+        line << "\n[按格式统计] 共 " << totalFiles << " 个文件，墙钟 " << wallSeconds << " s";
+        if (wallSeconds > 0) line << "，整体 " << totalFiles / wallSeconds << " 个/s";
+        line << "\n";
+        for (size_t i = 0; i < kFormatCount; ++i) {
+            const FormatStat& st = formats[i];
+            if (st.files == 0) continue;
+            double seconds = st.nanos / 1e9;
+            line << "  " << formatName(static_cast<Format>(i)) << ": " << st.files << " 个（失败 " << st.failed << "），";
+            if (seconds > 0) line << st.files / seconds << " 个/s，" << st.inputBytes / seconds / (1024 * 1024) << " MB/s，";
+            line << "p50 " << percentileMs(st.latencies, 0.50) << " ms，p99 " << percentileMs(st.latencies, 0.99) << " ms\n";
+        }
+    }
+
+    if (jsonPath.empty()) return;
+    std::ofstream json(jsonPath, std::ios::trunc);
+    if (!json) {
+        LogLine(std::cerr) << "[Warning] 统计报告写入失败: " << jsonPath << "\n";
+        return;
+    }
+    json << "{\n  \"wall_seconds\": " << wallSeconds << ",\n  \"files\": " << totalFiles << ",\n  \"stages\": {";
+    for (int i = 0; i < static_cast<int>(Stage::Count); ++i) {
+        json << (i ? "," : "") << "\n    \"" << kStageInfo[i].key << "\": { \"count\": " << stageCount[i]
+            << ", \"total_ms\": " << stageNanos[i] / 1e6 << " }";
+    }
+    json << "\n  },\n  \"formats\": {";
+    bool first = true;
+    for (size_t i = 0; i < kFormatCount; ++i) {
+        const FormatStat& st = formats[i];
+        if (st.files == 0) continue;
+        double seconds = st.nanos / 1e9;
+        json << (first ? "" : ",") << "\n    \"" << formatName(static_cast<Format>(i)) << "\": { \"files\": " << st.files
+            << ", \"failed\": " << st.failed << ", \"input_bytes\": " << st.inputBytes << ", \"output_bytes\": " << st.outputBytes
+            << ", \"total_ms\": " << st.nanos / 1e6
+            << ", \"files_per_sec\": " << (seconds > 0 ? st.files / seconds : 0)
+            << ", \"bytes_per_sec\": " << (seconds > 0 ? st.inputBytes / seconds : 0)
+            << ", \"p50_ms\": " << percentileMs(st.latencies, 0.50) << ", \"p99_ms\": " << percentileMs(st.latencies, 0.99) << " }";
+        first = false;
+    }
+    json << "\n  }\n}\n";
+}
+
+// ICO 文件头及图像条目的结构定义
+#pragma pack(push, 1)
+struct IconDir { uint16_t reserved, type, count; };
+struct IconDirEntry {
+    uint8_t width, height, colorCount, reserved;
+    uint16_t planes, bitCount;
+    uint32_t bytesInRes, imageOffset;
+};
+struct BitmapInfoHeader {
+    uint32_t size;
+    int32_t width, height;
+    uint16_t planes, bitCount;
+    uint32_t compression, sizeImage;
+    int32_t xPelsPerMeter, yPelsPerMeter;
+    uint32_t clrUsed, clrImportant;
+};
+#pragma pack(pop)
+
+// RGB 转 HSL
+HSL rgbToHsl(RGB rgb) {
+    float r = rgb.r / 255.0f, g = rgb.g / 255.0f, b = rgb.b / 255.0f;
+    float max = std::max({ r, g, b }), min = std::min({ r, g, b }), d = max - min;
+    HSL hsl; hsl.l = (max + min) / 2.0f;
+    if (d == 0) hsl.h = hsl.s = 0;
+    else {
+        hsl.s = hsl.l > 0.5f ? d / (2 - max - min) : d / (max + min);
+        if (max == r) hsl.h = (g - b) / d + (g < b ? 6 : 0);
+        else if (max == g) hsl.h = (b - r) / d + 2;
+        else hsl.h = (r - g) / d + 4;
+        hsl.h /= 6.0f;
+    }
+    return hsl;
+}
+
+// HSL 转 RGB
+RGB hslToRgb(HSL hsl) {
+    RGB rgb; rgb.a = 255;
+    if (hsl.s == 0) {
+        // 无饱和度：灰度色
+        rgb.r = rgb.g = rgb.b = static_cast<uint8_t>(hsl.l * 255);
+    }
+    else {
+        auto hue2rgb = [](float p, float q, float t) {
+            if (t < 0) t += 1; if (t > 1) t -= 1;
+            if (t < 1.0f / 6) return p + (q - p) * 6 * t;
+            if (t < 0.5f) return q;
+            if (t < 2.0f / 3) return p + (q - p) * (2.0f / 3 - t) * 6;
+            return p;
+            };
+        float q = hsl.l < 0.5f ? hsl.l * (1 + hsl.s) : hsl.l + hsl.s - hsl.l * hsl.s;
+        float p = 2 * hsl.l - q;
+        rgb.r = static_cast<uint8_t>(hue2rgb(p, q, hsl.h + 1.0f / 3) * 255);
+        rgb.g = static_cast<uint8_t>(hue2rgb(p, q, hsl.h) * 255);
+        rgb.b = static_cast<uint8_t>(hue2rgb(p, q, hsl.h - 1.0f / 3) * 255);
+    }
+    return rgb;
+}
+
+// ------------------- 亮度反转引擎 --------------------------
+// 所有像素路径（位图 / ICO 内 PNG / ICO 内 BMP / 兜底恢复）统一经由 invertRowBgr 处理。
+// 五种模式：
+// - Exact   : 逐像素走 rgbToHsl -> hslToRgb 浮点路径，作为校验基准
+// - Simd    : 向量化的浮点路径（见下方 SIMD 行内核），结果与 Exact 逐位一致，无需建表
+// - Lut     : 全量查找表，2^24 项 × 3 字节 ≈ 48MB，首次使用时构建
+// - Compact : 紧凑表，适合内存受限的机器，约 8MB
+// - Integer : 整数闭式公式（见下方整数闭式反转），与 Exact 最多相差 1
+//
+// 紧凑表的依据：H、S 不变而 L 取反时，浮点路径的结果恒为
+//     out = c + (255 - max - min) + e,  e ∈ {-1, 0}
+// 因此每个 RGB 只需记 3 位修正量（每通道 1 位），两个 RGB 共用 1 字节。
+static InversionMode g_inversionMode = InversionMode::Simd;
+
+void setInversionMode(InversionMode mode) { g_inversionMode = mode; }
+InversionMode inversionMode() { return g_inversionMode; }
+
+const char* inversionModeName(InversionMode mode) {
+    switch (mode) {
+    case InversionMode::Exact: return "exact";
+    case InversionMode::Simd: return "simd";
+    case InversionMode::Lut: return "lut";
+    case InversionMode::Compact: return "compact";
+    case InversionMode::Integer: return "integer";
+    }
+    return "?";
+}
+
+// 浮点基准：单像素 HSL 亮度反转（alpha 原样保留）
+inline RGB invertRgbExact(RGB rgb) {
+    HSL hsl = rgbToHsl(rgb);
+    hsl.l = 1.0f - hsl.l;
+    RGB out = hslToRgb(hsl);
+    out.a = rgb.a;
+    return out;
+}
+
+// 8 位像素在内存中的通道顺序：OpenCV 图像与 ICO 内的 BMP 为 B、G、R(、A)，minipng 解出的 PNG 为 R、G、B、A。
+// 浮点基准对 R、B 并不对称（交换输入的 R、B 后结果不一定恰好交换），因此各内核按顺序分别实例化，而不是先交换再处理。
+enum class ChannelOrder { Bgr, Rgb };
+
+constexpr int blueOffset(ChannelOrder order) { return order == ChannelOrder::Bgr ? 0 : 2; }
+constexpr int redOffset(ChannelOrder order) { return 2 - blueOffset(order); }
+
+template <ChannelOrder Order>
+static inline void invertPixelExact(uint8_t* px) {
+    constexpr int kB = blueOffset(Order), kR = redOffset(Order);
+    RGB out = invertRgbExact(RGB{ px[kR], px[1], px[kB], 255 });
+    px[kB] = out.b; px[1] = out.g; px[kR] = out.r;
+}
+
+// 查找表下标：按 B、G、R 的顺序拼接
+template <ChannelOrder Order>
+static inline uint32_t lutIndex(const uint8_t* px) {
+    return (uint32_t(px[blueOffset(Order)]) << 16) | (uint32_t(px[1]) << 8) | px[redOffset(Order)];
+}
+
+// 全量表：每项按 B、G、R 顺序存放反转结果，可直接覆盖像素
+static const std::vector<uint8_t>& fullInversionLut() {
+    static std::vector<uint8_t> lut;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        lut.resize(size_t(3) << 24);
+        uint8_t* p = lut.data();
+        for (int b = 0; b < 256; ++b)
+            for (int g = 0; g < 256; ++g)
+                for (int r = 0; r < 256; ++r, p += 3) {
+                    RGB out = invertRgbExact(RGB{ uint8_t(r), uint8_t(g), uint8_t(b), 255 });
+                    p[0] = out.b; p[1] = out.g; p[2] = out.r;
+                }
+        });
+    return lut;
+}
+
+// 紧凑表：低 3 位依次为 B、G、R 的修正位（1 表示减 1），奇数下标存高半字节。
+// 若当前编译器的浮点行为超出 {-1, 0} 的假设，构建时自动退回全量表。
+static const std::vector<uint8_t>* compactInversionLut() {
+    static std::vector<uint8_t> lut;
+    static bool usable = true;
+    static std::once_flag once;
+    std::call_once(once, [] {
+        lut.assign(size_t(1) << 23, 0);
+        for (int b = 0; b < 256 && usable; ++b)
+            for (int g = 0; g < 256 && usable; ++g)
+                for (int r = 0; r < 256; ++r) {
+                    RGB out = invertRgbExact(RGB{ uint8_t(r), uint8_t(g), uint8_t(b), 255 });
+                    int shift = 255 - std::max({ r, g, b }) - std::min({ r, g, b });
+                    int eb = b + shift - out.b, eg = g + shift - out.g, er = r + shift - out.r;
+                    if ((eb | eg | er) & ~1) { usable = false; break; }
+                    uint32_t idx = (uint32_t(b) << 16) | (uint32_t(g) << 8) | uint32_t(r);
+                    lut[idx >> 1] |= uint8_t((eb | (eg << 1) | (er << 2)) << ((idx & 1) * 4));
+                }
+        if (!usable) {
+            LogLine(std::cerr) << "[Warning] 紧凑反转表校验失败，改用全量查找表\n";
+            std::vector<uint8_t>().swap(lut);
+        }
+        });
+    return usable ? &lut : nullptr;
+}
+
+// ------------------- SIMD 行内核 --------------------------
+// 把浮点 HSL 路径逐运算地向量化：运算顺序、除法、截断方式与 rgbToHsl / hslToRgb 完全一致，
+// 分支改写为掩码混合，因此结果与 Exact 模式逐位相同（前提是编译时不开启 FMA 收缩）。
+// 指令集在运行时按 CPU 特性选择：AVX2（每轮 16 像素）> SSE4.1（每轮 8 像素）> 可移植版（每轮 8 像素）。
+static SimdLevel detectSimdLevel() {
+#if defined(ICONINV_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] >> 19) & 1;
+    bool osxsave = (info[2] >> 27) & 1, avx = (info[2] >> 28) & 1;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] >> 5) & 1;
+    }
+#else
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return SimdLevel::Avx2;
+    if (sse41) return SimdLevel::Sse41;
+#endif
+    return SimdLevel::Portable;
+}
+
+static SimdLevel g_simdLevel = detectSimdLevel();
+
+SimdLevel simdLevel() { return g_simdLevel; }
+
+// 强制使用较低的指令集（用于校验/对比）；超出 CPU 能力的请求会被忽略
+bool setSimdLevel(SimdLevel level) {
+    if (level > detectSimdLevel()) return false;
+    g_simdLevel = level;
+    return true;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Avx2: return "avx2";
+    case SimdLevel::Sse41: return "sse4.1";
+    default: return "portable";
+    }
+}
+
+// 可移植版：与向量版相同的无分支写法，交给编译器自动向量化
+template <ChannelOrder Order>
+static void invertBlockPortable(uint8_t* px, int stride) {
+    constexpr int N = 8, kB = blueOffset(Order), kR = redOffset(Order);
+    float r[N], g[N], b[N];
+    for (int k = 0; k < N; ++k) {
+        b[k] = px[k * stride + kB] / 255.0f;
+        g[k] = px[k * stride + 1] / 255.0f;
+        r[k] = px[k * stride + kR] / 255.0f;
+    }
+    auto hue2rgb = [](float p, float q, float t) {
+        t = t < 0 ? t + 1 : t;
+        t = t > 1 ? t - 1 : t;
+        float rise = p + (q - p) * 6 * t;
+        float fall = p + (q - p) * (2.0f / 3 - t) * 6;
+        return t < 1.0f / 6 ? rise : t < 0.5f ? q : t < 2.0f / 3 ? fall : p;
+        };
+    for (int k = 0; k < N; ++k) {
+        float mx = std::max(std::max(r[k], g[k]), b[k]), mn = std::min(std::min(r[k], g[k]), b[k]);
+        float d = mx - mn, l = (mx + mn) / 2.0f;
+        float s = l > 0.5f ? d / (2 - mx - mn) : d / (mx + mn);
+        float h = mx == r[k] ? (g[k] - b[k]) / d + (g[k] < b[k] ? 6 : 0)
+            : mx == g[k] ? (b[k] - r[k]) / d + 2 : (r[k] - g[k]) / d + 4;
+        h /= 6.0f;
+        l = 1.0f - l;
+        float q = l < 0.5f ? l * (1 + s) : l + s - l * s;
+        float p = 2 * l - q;
+        bool gray = d == 0;
+        r[k] = gray ? l * 255 : hue2rgb(p, q, h + 1.0f / 3) * 255;
+        g[k] = gray ? l * 255 : hue2rgb(p, q, h) * 255;
+        b[k] = gray ? l * 255 : hue2rgb(p, q, h - 1.0f / 3) * 255;
+    }
+    for (int k = 0; k < N; ++k) {
+        px[k * stride + kB] = static_cast<uint8_t>(b[k]);
+        px[k * stride + 1] = static_cast<uint8_t>(g[k]);
+        px[k * stride + kR] = static_cast<uint8_t>(r[k]);
+    }
+}
+
+#if defined(ICONINV_X86)
+ICONINV_TARGET("sse4.1")
+static inline __m128 hue2rgbSse(__m128 p, __m128 q, __m128 t) {
+    const __m128 one = _mm_set1_ps(1.0f), six = _mm_set1_ps(6.0f), twoThirds = _mm_set1_ps(2.0f / 3);
+    t = _mm_blendv_ps(t, _mm_add_ps(t, one), _mm_cmplt_ps(t, _mm_setzero_ps()));
+    t = _mm_blendv_ps(t, _mm_sub_ps(t, one), _mm_cmpgt_ps(t, one));
+    __m128 qp = _mm_sub_ps(q, p);
+    __m128 rise = _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(qp, six), t));
+    __m128 fall = _mm_add_ps(p, _mm_mul_ps(_mm_mul_ps(qp, _mm_sub_ps(twoThirds, t)), six));
+    __m128 v = _mm_blendv_ps(p, fall, _mm_cmplt_ps(t, twoThirds));
+    v = _mm_blendv_ps(v, q, _mm_cmplt_ps(t, _mm_set1_ps(0.5f)));
+    return _mm_blendv_ps(v, rise, _mm_cmplt_ps(t, _mm_set1_ps(1.0f / 6)));
+}
+
+// 4 个像素：输入输出均为 0..255 的 32 位整数
+ICONINV_TARGET("sse4.1")
+static inline void invertLanesSse(__m128i& ri, __m128i& gi, __m128i& bi) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    const __m128 k255 = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+    __m128 r = _mm_div_ps(_mm_cvtepi32_ps(ri), k255);
+    __m128 g = _mm_div_ps(_mm_cvtepi32_ps(gi), k255);
+    __m128 b = _mm_div_ps(_mm_cvtepi32_ps(bi), k255);
+    __m128 mx = _mm_max_ps(_mm_max_ps(r, g), b), mn = _mm_min_ps(_mm_min_ps(r, g), b);
+    __m128 d = _mm_sub_ps(mx, mn), sum = _mm_add_ps(mx, mn);
+    __m128 l = _mm_div_ps(sum, two);
+    __m128 gray = _mm_cmpeq_ps(d, zero);
+    __m128 s = _mm_blendv_ps(_mm_div_ps(d, sum), _mm_div_ps(d, _mm_sub_ps(_mm_sub_ps(two, mx), mn)), _mm_cmpgt_ps(l, half));
+    __m128 hr = _mm_add_ps(_mm_div_ps(_mm_sub_ps(g, b), d), _mm_and_ps(_mm_cmplt_ps(g, b), _mm_set1_ps(6.0f)));
+    __m128 hg = _mm_add_ps(_mm_div_ps(_mm_sub_ps(b, r), d), two);
+    __m128 hb = _mm_add_ps(_mm_div_ps(_mm_sub_ps(r, g), d), _mm_set1_ps(4.0f));
+    __m128 h = _mm_blendv_ps(hb, hg, _mm_cmpeq_ps(mx, g));
+    h = _mm_div_ps(_mm_blendv_ps(h, hr, _mm_cmpeq_ps(mx, r)), _mm_set1_ps(6.0f));
+    l = _mm_sub_ps(one, l);
+    __m128 q = _mm_blendv_ps(_mm_sub_ps(_mm_add_ps(l, s), _mm_mul_ps(l, s)), _mm_mul_ps(l, _mm_add_ps(one, s)), _mm_cmplt_ps(l, half));
+    __m128 p = _mm_sub_ps(_mm_mul_ps(two, l), q);
+    __m128 third = _mm_set1_ps(1.0f / 3), grayV = _mm_mul_ps(l, k255);
+    r = _mm_blendv_ps(_mm_mul_ps(hue2rgbSse(p, q, _mm_add_ps(h, third)), k255), grayV, gray);
+    g = _mm_blendv_ps(_mm_mul_ps(hue2rgbSse(p, q, h), k255), grayV, gray);
+    b = _mm_blendv_ps(_mm_mul_ps(hue2rgbSse(p, q, _mm_sub_ps(h, third)), k255), grayV, gray);
+    ri = _mm_cvttps_epi32(r); gi = _mm_cvttps_epi32(g); bi = _mm_cvttps_epi32(b);
+}
+
+// 4 个 32 位整数饱和压成 4 字节（packus 顺带把越界值钳到 0..255）
+ICONINV_TARGET("sse4.1")
+static inline int packLanesSse(__m128i v) {
+    return _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(v, v), v));
+}
+
+template <ChannelOrder Order>
+ICONINV_TARGET("sse4.1")
+static void invertBlockSse41(uint8_t* px, int stride) {
+    constexpr int kB = blueOffset(Order), kR = redOffset(Order);
+    alignas(16) uint8_t cb[8], cg[8], cr[8];
+    for (int k = 0; k < 8; ++k) { cb[k] = px[k * stride + kB]; cg[k] = px[k * stride + 1]; cr[k] = px[k * stride + kR]; }
+    for (int k = 0; k < 8; k += 4) {
+        __m128i r = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(cr + k)));
+        __m128i g = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(cg + k)));
+        __m128i b = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*reinterpret_cast<const int*>(cb + k)));
+        invertLanesSse(r, g, b);
+        int vr = packLanesSse(r), vg = packLanesSse(g), vb = packLanesSse(b);
+        std::memcpy(cr + k, &vr, 4); std::memcpy(cg + k, &vg, 4); std::memcpy(cb + k, &vb, 4);
+    }
+    for (int k = 0; k < 8; ++k) { px[k * stride + kB] = cb[k]; px[k * stride + 1] = cg[k]; px[k * stride + kR] = cr[k]; }
+}
+
+ICONINV_TARGET("avx2")
+static inline __m256 hue2rgbAvx(__m256 p, __m256 q, __m256 t) {
+    const __m256 one = _mm256_set1_ps(1.0f), six = _mm256_set1_ps(6.0f), twoThirds = _mm256_set1_ps(2.0f / 3);
+    t = _mm256_blendv_ps(t, _mm256_add_ps(t, one), _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ));
+    t = _mm256_blendv_ps(t, _mm256_sub_ps(t, one), _mm256_cmp_ps(t, one, _CMP_GT_OQ));
+    __m256 qp = _mm256_sub_ps(q, p);
+    __m256 rise = _mm256_add_ps(p, _mm256_mul_ps(_mm256_mul_ps(qp, six), t));
+    __m256 fall = _mm256_add_ps(p, _mm256_mul_ps(_mm256_mul_ps(qp, _mm256_sub_ps(twoThirds, t)), six));
+    __m256 v = _mm256_blendv_ps(p, fall, _mm256_cmp_ps(t, twoThirds, _CMP_LT_OQ));
+    v = _mm256_blendv_ps(v, q, _mm256_cmp_ps(t, _mm256_set1_ps(0.5f), _CMP_LT_OQ));
+    return _mm256_blendv_ps(v, rise, _mm256_cmp_ps(t, _mm256_set1_ps(1.0f / 6), _CMP_LT_OQ));
+}
+
+// 8 个像素：输入输出均为 0..255 的 32 位整数
+ICONINV_TARGET("avx2")
+static inline void invertLanesAvx(__m256i& ri, __m256i& gi, __m256i& bi) {
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 k255 = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+    __m256 r = _mm256_div_ps(_mm256_cvtepi32_ps(ri), k255);
+    __m256 g = _mm256_div_ps(_mm256_cvtepi32_ps(gi), k255);
+    __m256 b = _mm256_div_ps(_mm256_cvtepi32_ps(bi), k255);
+    __m256 mx = _mm256_max_ps(_mm256_max_ps(r, g), b), mn = _mm256_min_ps(_mm256_min_ps(r, g), b);
+    __m256 d = _mm256_sub_ps(mx, mn), sum = _mm256_add_ps(mx, mn);
+    __m256 l = _mm256_div_ps(sum, two);
+    __m256 gray = _mm256_cmp_ps(d, zero, _CMP_EQ_OQ);
+    __m256 s = _mm256_blendv_ps(_mm256_div_ps(d, sum),
+        _mm256_div_ps(d, _mm256_sub_ps(_mm256_sub_ps(two, mx), mn)), _mm256_cmp_ps(l, half, _CMP_GT_OQ));
+    __m256 hr = _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(g, b), d),
+        _mm256_and_ps(_mm256_cmp_ps(g, b, _CMP_LT_OQ), _mm256_set1_ps(6.0f)));
+    __m256 hg = _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(b, r), d), two);
+    __m256 hb = _mm256_add_ps(_mm256_div_ps(_mm256_sub_ps(r, g), d), _mm256_set1_ps(4.0f));
+    __m256 h = _mm256_blendv_ps(hb, hg, _mm256_cmp_ps(mx, g, _CMP_EQ_OQ));
+    h = _mm256_div_ps(_mm256_blendv_ps(h, hr, _mm256_cmp_ps(mx, r, _CMP_EQ_OQ)), _mm256_set1_ps(6.0f));
+    l = _mm256_sub_ps(one, l);
+    __m256 q = _mm256_blendv_ps(_mm256_sub_ps(_mm256_add_ps(l, s), _mm256_mul_ps(l, s)),
+        _mm256_mul_ps(l, _mm256_add_ps(one, s)), _mm256_cmp_ps(l, half, _CMP_LT_OQ));
+    __m256 p = _mm256_sub_ps(_mm256_mul_ps(two, l), q);
+    __m256 third = _mm256_set1_ps(1.0f / 3), grayV = _mm256_mul_ps(l, k255);
+    r = _mm256_blendv_ps(_mm256_mul_ps(hue2rgbAvx(p, q, _mm256_add_ps(h, third)), k255), grayV, gray);
+    g = _mm256_blendv_ps(_mm256_mul_ps(hue2rgbAvx(p, q, h), k255), grayV, gray);
+    b = _mm256_blendv_ps(_mm256_mul_ps(hue2rgbAvx(p, q, _mm256_sub_ps(h, third)), k255), grayV, gray);
+    ri = _mm256_cvttps_epi32(r); gi = _mm256_cvttps_epi32(g); bi = _mm256_cvttps_epi32(b);
+}
+
+ICONINV_TARGET("avx2")
+static inline __m128i packLanesAvx(__m256i v) {
+    __m128i w = _mm_packus_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    return _mm_packus_epi16(w, w);
+}
+
+template <ChannelOrder Order>
+ICONINV_TARGET("avx2")
+static void invertBlockAvx2(uint8_t* px, int stride) {
+    constexpr int kB = blueOffset(Order), kR = redOffset(Order);
+    alignas(32) uint8_t cb[16], cg[16], cr[16];
+    for (int k = 0; k < 16; ++k) { cb[k] = px[k * stride + kB]; cg[k] = px[k * stride + 1]; cr[k] = px[k * stride + kR]; }
+    for (int k = 0; k < 16; k += 8) {
+        __m256i r = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr + k)));
+        __m256i g = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cg + k)));
+        __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb + k)));
+        invertLanesAvx(r, g, b);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(cr + k), packLanesAvx(r));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(cg + k), packLanesAvx(g));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(cb + k), packLanesAvx(b));
+    }
+    for (int k = 0; k < 16; ++k) { px[k * stride + kB] = cb[k]; px[k * stride + 1] = cg[k]; px[k * stride + kR] = cr[k]; }
+}
+#endif
+
+// SIMD 模式的行处理：整块交给当前指令集的内核，尾部不足一块的像素走浮点基准
+template <ChannelOrder Order>
+static void invertRowSimd(uint8_t* px, size_t count, int stride) {
+    size_t i = 0;
+    switch (g_simdLevel) {
+#if defined(ICONINV_X86)
+    case SimdLevel::Avx2:
+        for (; i + 16 <= count; i += 16) invertBlockAvx2<Order>(px + i * stride, stride);
+        break;
+    case SimdLevel::Sse41:
+        for (; i + 8 <= count; i += 8) invertBlockSse41<Order>(px + i * stride, stride);
+        break;
+#endif
+    default:
+        for (; i + 8 <= count; i += 8) invertBlockPortable<Order>(px + i * stride, stride);
+        break;
+    }
+    for (px += i * stride; i < count; ++i, px += stride) invertPixelExact<Order>(px);
+}
+
+// ------------------- 整数闭式反转 --------------------------
+// H、S 不变而 L 取反时，色度 C = max - min 不变，三个通道平移同一个量 1 - (max + min)（按 0..1 计）。
+// 换算到 0..255：
+//     out = c + 255 - max - min = (255 - min) - (max - c)
+// 这是实数意义下的精确解，浮点基准截断取整，多数值比它小 1（即紧凑表里的修正位）。
+// 后一种写法的每个中间量都落在 0..255 内，8 位无符号运算既不溢出也无需扩宽，
+// 向量版一次处理 4 / 8 个像素，没有除法与分支。公式对三个通道对称，BGR 与 RGB 顺序共用同一组内核。
+
+static inline void invertPixelInteger(uint8_t* px) {
+    uint8_t mx = std::max({ px[0], px[1], px[2] }), mn = std::min({ px[0], px[1], px[2] });
+    uint8_t top = uint8_t(255 - mn);
+    px[0] = uint8_t(top - (mx - px[0]));
+    px[1] = uint8_t(top - (mx - px[1]));
+    px[2] = uint8_t(top - (mx - px[2]));
+}
+
+inline RGB invertRgbInteger(RGB rgb) {
+    uint8_t bgr[3] = { rgb.b, rgb.g, rgb.r };
+    invertPixelInteger(bgr);
+    return RGB{ bgr[2], bgr[1], bgr[0], rgb.a };
+}
+
+#if defined(ICONINV_X86)
+// 每个 32 位通道是一个像素 [B, G, R, X]：三通道的 max / min 落在最低字节，再广播回 B、G、R；X 保持原值
+ICONINV_TARGET("sse4.1")
+static inline __m128i invertQuadInteger(__m128i v) {
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1);
+    const __m128i keepX = _mm_set1_epi32(int(0xFF000000u));
+    __m128i s8 = _mm_srli_epi32(v, 8), s16 = _mm_srli_epi32(v, 16);
+    __m128i mx = _mm_shuffle_epi8(_mm_max_epu8(_mm_max_epu8(v, s8), s16), spread);
+    __m128i mn = _mm_shuffle_epi8(_mm_min_epu8(_mm_min_epu8(v, s8), s16), spread);
+    __m128i top = _mm_xor_si128(mn, _mm_set1_epi8(-1));
+    return _mm_blendv_epi8(_mm_sub_epi8(top, _mm_sub_epi8(mx, v)), v, keepX);
+}
+
+ICONINV_TARGET("avx2")
+static inline __m256i invertOctInteger(__m256i v) {
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1,
+        0, 0, 0, -1, 4, 4, 4, -1, 8, 8, 8, -1, 12, 12, 12, -1);
+    const __m256i keepX = _mm256_set1_epi32(int(0xFF000000u));
+    __m256i s8 = _mm256_srli_epi32(v, 8), s16 = _mm256_srli_epi32(v, 16);
+    __m256i mx = _mm256_shuffle_epi8(_mm256_max_epu8(_mm256_max_epu8(v, s8), s16), spread);
+    __m256i mn = _mm256_shuffle_epi8(_mm256_min_epu8(_mm256_min_epu8(v, s8), s16), spread);
+    __m256i top = _mm256_xor_si256(mn, _mm256_set1_epi8(-1));
+    return _mm256_blendv_epi8(_mm256_sub_epi8(top, _mm256_sub_epi8(mx, v)), v, keepX);
+}
+
+// BGR 紧密排列时，先把 4 个像素（12 字节）展开成 4 字节一格，算完再压回
+static const int8_t kExpandBgr[16] = { 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 };
+static const int8_t kPackBgr[16] = { 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 };
+
+// 返回已处理的像素数，其余交给标量尾部
+ICONINV_TARGET("sse4.1")
+static size_t invertRowIntegerSse41(uint8_t* px, size_t count, int stride) {
+    size_t i = 0;
+    if (stride == 4) {
+        for (; i + 4 <= count; i += 4) {
+            __m128i* p = reinterpret_cast<__m128i*>(px + i * 4);
+            _mm_storeu_si128(p, invertQuadInteger(_mm_loadu_si128(p)));
+        }
+        return i;
+    }
+    const __m128i expand = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kExpandBgr));
+    const __m128i pack = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kPackBgr));
+    // 每次读 16 字节、只写回 12 字节，保证读取不越过行尾
+    for (; i + 6 <= count; i += 4) {
+        uint8_t* p = px + i * 3;
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), expand);
+        __m128i out = _mm_shuffle_epi8(invertQuadInteger(v), pack);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), out);
+        int tail = _mm_extract_epi32(out, 2);
+        std::memcpy(p + 8, &tail, 4);
+    }
+    return i;
+}
+
+ICONINV_TARGET("avx2")
+static size_t invertRowIntegerAvx2(uint8_t* px, size_t count, int stride) {
+    size_t i = 0;
+    if (stride == 4) {
+        for (; i + 8 <= count; i += 8) {
+            __m256i* p = reinterpret_cast<__m256i*>(px + i * 4);
+            _mm256_storeu_si256(p, invertOctInteger(_mm256_loadu_si256(p)));
+        }
+        return i;
+    }
+    const __m128i expand128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kExpandBgr));
+    const __m128i pack128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kPackBgr));
+    const __m256i expand = _mm256_broadcastsi128_si256(expand128), pack = _mm256_broadcastsi128_si256(pack128);
+    // 两个 128 位半区各装 4 个像素（起点相隔 12 字节），最后一次读到第 28 字节，故至少剩 10 个像素
+    for (; i + 10 <= count; i += 8) {
+        uint8_t* p = px + i * 3;
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+        __m256i out = _mm256_shuffle_epi8(invertOctInteger(_mm256_shuffle_epi8(v, expand)), pack);
+        __m128i lo = _mm256_castsi256_si128(out), hi = _mm256_extracti128_si256(out, 1);
+        int loTail = _mm_extract_epi32(lo, 2), hiTail = _mm_extract_epi32(hi, 2);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), lo);
+        std::memcpy(p + 8, &loTail, 4);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p + 12), hi);
+        std::memcpy(p + 20, &hiTail, 4);
+    }
+    return i;
+}
+#endif
+
+static void invertRowInteger(uint8_t* px, size_t count, int stride) {
+    size_t i = 0;
+    switch (g_simdLevel) {
+#if defined(ICONINV_X86)
+    case SimdLevel::Avx2:
+        i = invertRowIntegerAvx2(px, count, stride);
+        break;
+    case SimdLevel::Sse41:
+        i = invertRowIntegerSse41(px, count, stride);
+        break;
+#endif
+    default:
+        break;
+    }
+    for (px += i * stride; i < count; ++i, px += stride) invertPixelInteger(px);
+}
+
+// 对一行（或任意连续区段）8 位像素做亮度反转；stride 为每像素字节数（3 或 4），alpha 不变
+template <ChannelOrder Order>
+static void invertRow8(uint8_t* px, size_t count, int stride) {
+    InversionMode mode = g_inversionMode;
+    const std::vector<uint8_t>* compact = nullptr;
+    if (mode == InversionMode::Compact) {
+        compact = compactInversionLut();
+        if (!compact) mode = InversionMode::Lut;
+    }
+    switch (mode) {
+    case InversionMode::Simd:
+        invertRowSimd<Order>(px, count, stride);
+        break;
+    case InversionMode::Integer:
+        invertRowInteger(px, count, stride);
+        break;
+    case InversionMode::Exact:
+        for (size_t i = 0; i < count; ++i, px += stride) invertPixelExact<Order>(px);
+        break;
+    case InversionMode::Lut: {
+        constexpr int kB = blueOffset(Order), kR = redOffset(Order);
+        const uint8_t* lut = fullInversionLut().data();
+        for (size_t i = 0; i < count; ++i, px += stride) {
+            const uint8_t* e = lut + size_t(lutIndex<Order>(px)) * 3;
+            px[kB] = e[0]; px[1] = e[1]; px[kR] = e[2];
+        }
+        break;
+    }
+    case InversionMode::Compact: {
+        constexpr int kB = blueOffset(Order), kR = redOffset(Order);
+        const uint8_t* lut = compact->data();
+        for (size_t i = 0; i < count; ++i, px += stride) {
+            uint32_t idx = lutIndex<Order>(px);
+            int fix = lut[idx >> 1] >> ((idx & 1) * 4);
+            int shift = 255 - std::max({ px[0], px[1], px[2] }) - std::min({ px[0], px[1], px[2] });
+            px[kB] = uint8_t(px[kB] + shift - (fix & 1));
+            px[1] = uint8_t(px[1] + shift - ((fix >> 1) & 1));
+            px[kR] = uint8_t(px[kR] + shift - ((fix >> 2) & 1));
+        }
+        break;
+    }
+    }
+}
+
+// BGR / BGRA 排列的 8 位像素（OpenCV 图像、ICO 内的 32 位 BMP）
+static void invertRowBgr(uint8_t* px, size_t count, int stride) {
+    invertRow8<ChannelOrder::Bgr>(px, count, stride);
+}
+
+// ------------------- 像素布局分派 --------------------------
+// cv::imdecode(IMREAD_UNCHANGED) 按文件内容给出 8U / 16U（16 位 PNG）/ 32F 深度、1 / 3 / 4 通道的图像，
+// minipng 给出 R、G、B、A 顺序的 8 位像素。每种组合在编译期实例化一个行内核，
+// 整幅图像只按类型分派一次，行内循环里不再有类型判断：
+// - 8U 三 / 四通道：按当前 InversionMode 走上面的各实现
+// - 8U 单通道：灰色 (v, v, v) 的结果只取决于 v，按当前模式查 256 项的表，输出仍为单通道
+// - 8U 三 / 四通道中整行无彩色（B = G = R）的行：同样查表，不走 HSL 计算（单色图标几乎全是这种行）
+// - 16U / 32F：没有浮点基准可对齐，直接用闭式公式 c + top - max - min（top 为 65535 或 1.0）
+// 第 4 通道为 alpha，原样保留；完全透明（alpha = 0）的像素按 TransparentPixels 设置处理。
+
+// 四通道行内核对 alpha 的处理：
+// - Preserve         : 所有像素照常反转
+// - SkipTransparent  : 按 alpha 把行切成连续段，只反转可见段
+// - ClearTransparent : 同上，并把透明段的颜色清零
+enum class AlphaPolicy { None, Preserve, SkipTransparent, ClearTransparent };
+
+static TransparentPixels g_transparentPixels = TransparentPixels::Invert;
+
+void setTransparentPixels(TransparentPixels mode) { g_transparentPixels = mode; }
+TransparentPixels transparentPixels() { return g_transparentPixels; }
+
+using RowKernel = void (*)(uint8_t* row, size_t count);
+
+template <typename T> struct PixelTraits;
+// load 取出参与计算的通道值。浮点图像可能带有 [0, 1] 以外的值（HDR、IMREAD_ANYDEPTH 读入的 EXR / TIFF 等），
+// 先钳到 [0, 1]（NaN 视为 0），保证输出仍落在同一范围内
+template <> struct PixelTraits<uint16_t> {
+    using Wide = int32_t;
+    static constexpr Wide kTop = 65535;
+    static Wide load(uint16_t v) { return v; }
+};
+template <> struct PixelTraits<float> {
+    using Wide = float;
+    static constexpr Wide kTop = 1.0f;
+    static Wide load(float v) { return v > 0.0f ? std::min(v, kTop) : 0.0f; }
+};
+
+// 四通道行按 alpha 切段：alpha = 0 的连续段不反转（Clear 时顺带把颜色清零），其余每段交给 visible
+template <typename T, AlphaPolicy Alpha>
+static void forEachVisibleSpan(uint8_t* bytes, size_t count, void (*visible)(uint8_t*, size_t)) {
+    T* px = reinterpret_cast<T*>(bytes);
+    size_t i = 0;
+    while (i < count) {
+        size_t start = i;
+        while (i < count && px[i * 4 + 3] == T(0)) ++i;
+        if constexpr (Alpha == AlphaPolicy::ClearTransparent) {
+            for (size_t k = start; k < i; ++k) px[k * 4] = px[k * 4 + 1] = px[k * 4 + 2] = T(0);
+        }
+        start = i;
+        while (i < count && px[i * 4 + 3] != T(0)) ++i;
+        if (i > start) visible(reinterpret_cast<uint8_t*>(px + start * 4), i - start);
+    }
+}
+
+// 16U / 32F：闭式公式对三个通道对称，Order 不影响结果
+template <typename T, int Channels, ChannelOrder Order, AlphaPolicy Alpha>
+struct PixelKernel {
+    static_assert(Channels == 1 || Channels == 3 || Channels == 4, "只支持 1 / 3 / 4 通道");
+    static_assert((Alpha != AlphaPolicy::None) == (Channels == 4), "只有四通道图像带 alpha");
+
+    static void row(uint8_t* bytes, size_t count) {
+        if constexpr (Alpha == AlphaPolicy::SkipTransparent || Alpha == AlphaPolicy::ClearTransparent) {
+            forEachVisibleSpan<T, Alpha>(bytes, count, &PixelKernel<T, Channels, Order, AlphaPolicy::Preserve>::row);
+            return;
+        }
+        using W = typename PixelTraits<T>::Wide;
+        constexpr W top = PixelTraits<T>::kTop;
+        T* px = reinterpret_cast<T*>(bytes);
+        for (size_t i = 0; i < count; ++i, px += Channels) {
+            if constexpr (Channels == 1) {
+                px[0] = T(top - PixelTraits<T>::load(px[0]));
+            }
+            else {
+                W c0 = PixelTraits<T>::load(px[0]), c1 = PixelTraits<T>::load(px[1]), c2 = PixelTraits<T>::load(px[2]);
+                W shift = top - std::max({ c0, c1, c2 }) - std::min({ c0, c1, c2 });
+                px[0] = T(c0 + shift); px[1] = T(c1 + shift); px[2] = T(c2 + shift);
+            }
+        }
+    }
+};
+
+// 单通道 8 位的反转表：[0] 为浮点基准（Exact / Simd / Lut / Compact 共用），[1] 为 Integer 的 255 - v
+static const uint8_t* grayInversionTable() {
+    static const auto tables = [] {
+        std::array<std::array<uint8_t, 256>, 2> t{};
+        for (int v = 0; v < 256; ++v) {
+            t[0][v] = invertRgbExact(RGB{ uint8_t(v), uint8_t(v), uint8_t(v), 255 }).r;
+            t[1][v] = uint8_t(255 - v);
+        }
+        return t;
+    }();
+    return tables[g_inversionMode == InversionMode::Integer].data();
+}
+
+// 整行是否无彩色：按 16 像素一块累积差异位，块内无分支，遇到彩色块即返回。
+// 每个像素按一个 32 位字读入（小端下前三个通道依次在低 3 字节），与右移 8 位的自身异或，低 16 位全零即三通道相等；
+// 三通道时这个字的最高字节属于下一个像素、被掩码丢弃，所以整块之后至少还要留一个像素，避免读出行尾
+template <int Channels>
+static bool isAchromaticRow(const uint8_t* px, size_t count) {
+    size_t i = 0;
+    for (; i + 17 <= count; i += 16, px += 16 * Channels) {
+        uint32_t diff = 0;
+        for (int k = 0; k < 16; ++k) {
+            uint32_t v;
+            std::memcpy(&v, px + k * Channels, 4);
+            diff |= v ^ (v >> 8);
+        }
+        if (diff & 0xFFFF) return false;
+    }
+    for (; i < count; ++i, px += Channels)
+        if (px[0] != px[1] || px[1] != px[2]) return false;
+    return true;
+}
+
+template <int Channels, ChannelOrder Order, AlphaPolicy Alpha>
+struct PixelKernel<uint8_t, Channels, Order, Alpha> {
+    static void row(uint8_t* px, size_t count) {
+        if constexpr (Alpha == AlphaPolicy::SkipTransparent || Alpha == AlphaPolicy::ClearTransparent) {
+            forEachVisibleSpan<uint8_t, Alpha>(px, count, &PixelKernel<uint8_t, Channels, Order, AlphaPolicy::Preserve>::row);
+        }
+        else if constexpr (Channels == 1) {
+            const uint8_t* table = grayInversionTable();
+            for (size_t i = 0; i < count; ++i) px[i] = table[px[i]];
+        }
+        else {
+            // Integer 本身只有几条整数指令，检测反而多花时间
+            if (g_inversionMode != InversionMode::Integer && isAchromaticRow<Channels>(px, count)) {
+                const uint8_t* table = grayInversionTable();
+                for (size_t i = 0; i < count; ++i, px += Channels) px[0] = px[1] = px[2] = table[px[0]];
+                return;
+            }
+            invertRow8<Order>(px, count, Channels);
+        }
+    }
+};
+
+template <typename T, ChannelOrder Order>
+static RowKernel selectRowKernel(int channels, AlphaPolicy alpha) {
+    switch (channels) {
+    case 1: return &PixelKernel<T, 1, Order, AlphaPolicy::None>::row;
+    case 3: return &PixelKernel<T, 3, Order, AlphaPolicy::None>::row;
+    case 4:
+        switch (alpha) {
+        case AlphaPolicy::SkipTransparent: return &PixelKernel<T, 4, Order, AlphaPolicy::SkipTransparent>::row;
+        case AlphaPolicy::ClearTransparent: return &PixelKernel<T, 4, Order, AlphaPolicy::ClearTransparent>::row;
+        default: return &PixelKernel<T, 4, Order, AlphaPolicy::Preserve>::row;
+        }
+    default: return nullptr;
+    }
+}
+
+// 不支持的组合返回 nullptr
+static RowKernel selectRowKernel(int depth, int channels, ChannelOrder order, AlphaPolicy alpha) {
+    switch (depth) {
+    case CV_8U:
+        return order == ChannelOrder::Bgr ? selectRowKernel<uint8_t, ChannelOrder::Bgr>(channels, alpha)
+            : selectRowKernel<uint8_t, ChannelOrder::Rgb>(channels, alpha);
+    case CV_16U:
+        return selectRowKernel<uint16_t, ChannelOrder::Bgr>(channels, alpha);
+    case CV_32F:
+        return selectRowKernel<float, ChannelOrder::Bgr>(channels, alpha);
+    default:
+        return nullptr;
+    }
+}
+
+template <typename T>
+static bool hasVisiblePixel(const uint8_t* data, int rows, int cols, size_t step) {
+    for (int y = 0; y < rows; ++y) {
+        const T* px = reinterpret_cast<const T*>(data + y * step);
+        for (int x = 0; x < cols; ++x)
+            if (px[x * 4 + 3] != T(0)) return true;
+    }
+    return false;
+}
+
+// 四通道图像本次采用的 alpha 处理。整幅图的 alpha 全为 0 时视为 alpha 未被使用
+// （老式 32 位 ICO 位图靠 AND 掩码表示透明，alpha 字节一律填 0），照常反转全部像素
+static AlphaPolicy alphaPolicyFor(const uint8_t* data, int rows, int cols, size_t step, int depth) {
+    if (g_transparentPixels == TransparentPixels::Invert) return AlphaPolicy::Preserve;
+    bool visible = depth == CV_8U ? hasVisiblePixel<uint8_t>(data, rows, cols, step)
+        : depth == CV_16U ? hasVisiblePixel<uint16_t>(data, rows, cols, step)
+        : depth == CV_32F ? hasVisiblePixel<float>(data, rows, cols, step) : true;
+    if (!visible) return AlphaPolicy::Preserve;
+    return g_transparentPixels == TransparentPixels::Skip ? AlphaPolicy::SkipTransparent : AlphaPolicy::ClearTransparent;
+}
+
+// 大图按行带（row band）交给 cv::parallel_for_ 并行；像素数低于阈值时保持单线程，
+// 免得小图标为线程调度买单。每个行带至少 kMinBandPixels 个像素。
+constexpr size_t kParallelPixelThreshold = 512 * 512;
+constexpr size_t kMinBandPixels = 64 * 1024;
+
+// 就地反转 rows 行、每行 cols 个像素、行间距 step 字节的图像；深度或通道数不支持时返回 false，像素不变
+static bool invertPixels(uint8_t* data, int rows, int cols, size_t step, int depth, int channels, ChannelOrder order) {
+    AlphaPolicy alpha = channels == 4 ? alphaPolicyFor(data, rows, cols, step, depth) : AlphaPolicy::None;
+    RowKernel kernel = selectRowKernel(depth, channels, order, alpha);
+    if (!kernel) return false;
+    size_t pixels = static_cast<size_t>(rows) * cols;
+    if (pixels < kParallelPixelThreshold || rows < 2) {
+        for (int y = 0; y < rows; ++y) kernel(data + y * step, cols);
+        return true;
+    }
+    double stripes = std::min<double>(rows, static_cast<double>(pixels / kMinBandPixels));
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& band) {
+        for (int y = band.start; y < band.end; ++y) kernel(data + y * step, cols);
+        }, stripes);
+    return true;
+}
+
+// 处理 OpenCV 图像亮度反转
+bool invertBrightness(cv::Mat& image) {
+    return invertPixels(image.data, image.rows, image.cols, static_cast<size_t>(image.step),
+        image.depth(), image.channels(), ChannelOrder::Bgr);
+}
+
+// ------------------- 反转校验 --------------------------
+
+// 校验的像素布局：OpenCV 的 BGR / BGRA 与 minipng 的 RGB / RGBA 走不同的模板实例，四通道另查 alpha 是否被改动
+struct VerifyLayout { const char* name; ChannelOrder order; int stride; };
+static const VerifyLayout kVerifyLayouts[] = {
+    { "BGR", ChannelOrder::Bgr, 3 }, { "BGRA", ChannelOrder::Bgr, 4 },
+    { "RGB", ChannelOrder::Rgb, 3 }, { "RGBA", ChannelOrder::Rgb, 4 },
+};
+
+// 每轮固定 B、遍历全部 G、R（65536 个像素），先算浮点基准，再让各实现按各布局处理同一批像素并逐通道比较。
+// 四通道的 alpha 取随像素变化的非平凡值（含 0 与 255），处理后必须原样不变
+std::vector<InversionCheck> verifyInversion(const std::vector<InversionMode>& modes) {
+    constexpr size_t kBatch = size_t(1) << 16;
+    constexpr size_t kLayouts = sizeof(kVerifyLayouts) / sizeof(kVerifyLayouts[0]);
+    std::vector<InversionCheck> results(modes.size() * kLayouts);
+    InversionMode saved = g_inversionMode;
+    for (size_t m = 0; m < modes.size(); ++m) {
+        for (size_t l = 0; l < kLayouts; ++l) {
+            results[m * kLayouts + l].mode = modes[m];
+            results[m * kLayouts + l].layout = kVerifyLayouts[l].name;
+        }
+        // 先处理一个像素，让查找表在计时之外建好
+        uint8_t warm[3] = { 1, 2, 3 };
+        g_inversionMode = modes[m];
+        invertRowBgr(warm, 1, 3);
+    }
+    // expected 按 R、G、B 顺序存放基准结果
+    std::vector<uint8_t> expected(kBatch * 3), alpha(kBatch), actual(kBatch * 4);
+    for (int b = 0; b < 256; ++b) {
+        for (size_t k = 0; k < kBatch; ++k) {
+            uint8_t g = uint8_t(k >> 8), r = uint8_t(k);
+            RGB out = invertRgbExact(RGB{ r, g, uint8_t(b), 255 });
+            expected[k * 3] = out.r; expected[k * 3 + 1] = out.g; expected[k * 3 + 2] = out.b;
+            alpha[k] = uint8_t(r * 7 + g * 13 + b * 29);
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+            InversionCheck& res = results[i];
+            const VerifyLayout& layout = kVerifyLayouts[i % kLayouts];
+            int stride = layout.stride;
+            int kR = layout.order == ChannelOrder::Rgb ? 0 : 2, kB = 2 - kR;
+            for (size_t k = 0; k < kBatch; ++k) {
+                uint8_t* p = actual.data() + k * stride;
+                p[kR] = uint8_t(k); p[1] = uint8_t(k >> 8); p[kB] = uint8_t(b);
+                if (stride == 4) p[3] = alpha[k];
+            }
+            g_inversionMode = res.mode;
+            auto start = std::chrono::steady_clock::now();
+            if (layout.order == ChannelOrder::Rgb) invertRow8<ChannelOrder::Rgb>(actual.data(), kBatch, stride);
+            else invertRow8<ChannelOrder::Bgr>(actual.data(), kBatch, stride);
+            res.nanos += nanosSince(start);
+            for (size_t k = 0; k < kBatch; ++k) {
+                const uint8_t* p = actual.data() + k * stride;
+                const uint8_t* e = expected.data() + k * 3;
+                int dev = std::max({ std::abs(p[kR] - e[0]), std::abs(p[1] - e[1]), std::abs(p[kB] - e[2]) });
+                if (stride == 4 && p[3] != alpha[k]) ++res.alphaChanged;
+                if (dev == 0) continue;
+                ++res.mismatched;
+                res.maxDeviation = std::max(res.maxDeviation, dev);
+            }
+            res.checked += kBatch;
+        }
+    }
+    g_inversionMode = saved;
+    return results;
+}
+
+// RGB 转 HEX 颜色字符串，写入调用方提供的缓冲区（"#RRGGBB" + '\0'）
+static void rgbToHex(RGB rgb, char (&buf)[8]) {
+    static const char kDigits[] = "0123456789ABCDEF";
+    const uint8_t ch[3] = { rgb.r, rgb.g, rgb.b };
+    buf[0] = '#';
+    for (int i = 0; i < 3; ++i) {
+        buf[1 + i * 2] = kDigits[ch[i] >> 4];
+        buf[2 + i * 2] = kDigits[ch[i] & 0xF];
+    }
+    buf[7] = '\0';
+}
+
+// 小工具：去空白 & 大小写不敏感比较（均基于 string_view，不分配内存）
+static inline bool isTrimSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+static inline std::string_view trim(std::string_view s) {
+    while (!s.empty() && isTrimSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isTrimSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+constexpr char asciiLower(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+static inline bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (asciiLower(a[i]) != asciiLower(b[i])) return false;
+    }
+    return true;
+}
+static inline bool istartsWith(std::string_view s, std::string_view prefix) {
+    return s.size() >= prefix.size() && iequals(s.substr(0, prefix.size()), prefix);
+}
+static inline int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = asciiLower(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// 解析 #RGB / #RRGGBB / #RRGGBBAA（忽略 alpha）；含非十六进制字符时返回 false
+static bool parseHexColor(std::string_view hex, RGB& out) {
+    if (hex.empty() || hex[0] != '#') return false;
+    if (hex.size() != 4 && hex.size() != 7 && hex.size() != 9) return false;
+    int d[8];
+    for (size_t i = 1; i < hex.size(); ++i) {
+        if ((d[i - 1] = hexDigit(hex[i])) < 0) return false;
+    }
+    if (hex.size() == 4) { // #RGB
+        out = RGB{ uint8_t(d[0] * 17), uint8_t(d[1] * 17), uint8_t(d[2] * 17), 255 };
+    }
+    else { // #RRGGBB / #RRGGBBAA
+        out = RGB{ uint8_t(d[0] * 16 + d[1]), uint8_t(d[2] * 16 + d[3]), uint8_t(d[4] * 16 + d[5]), 255 };
+    }
+    return true;
+}
+
+// 手写的 CSS 小扫描器：只在原字符串上移动指针，不分配内存
+struct CssScanner {
+    const char* p;
+    const char* end;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+    // 跳过空白，返回是否跳过了至少一个字符
+    bool skipWs() {
+        const char* start = p;
+        while (p < end && isSpace(*p)) ++p;
+        return p != start;
+    }
+    bool eat(char c) {
+        if (p < end && *p == c) { ++p; return true; }
+        return false;
+    }
+    // 大小写不敏感地匹配小写关键字
+    bool eatWord(const char* word) {
+        const char* q = p;
+        for (; *word; ++word, ++q) {
+            if (q >= end || asciiLower(*q) != *word) return false;
+        }
+        p = q;
+        return true;
+    }
+    // CSS <number> / <percentage>：[+-]? 数字 [. 数字]，至少一位数字，可带 %
+    bool number(double& value, bool& percent) {
+        const char* q = p;
+        bool neg = false;
+        if (q < end && (*q == '+' || *q == '-')) neg = *q++ == '-';
+        double v = 0;
+        int digits = 0;
+        for (; q < end && *q >= '0' && *q <= '9'; ++q, ++digits) v = v * 10 + (*q - '0');
+        if (q < end && *q == '.') {
+            double scale = 0.1;
+            for (++q; q < end && *q >= '0' && *q <= '9'; ++q, ++digits, scale *= 0.1) v += (*q - '0') * scale;
+        }
+        if (digits == 0) return false;
+        percent = q < end && *q == '%';
+        if (percent) ++q;
+        value = neg ? -v : v;
+        p = q;
+        return true;
+    }
+};
+
+// 通道值：数字按 0..255，百分比按 0%..100% 映射，超界钳位后四舍五入
+static inline uint8_t cssChannel(double v, bool percent) {
+    if (percent) v = v * 255.0 / 100.0;
+    v = std::min(255.0, std::max(0.0, v));
+    return static_cast<uint8_t>(std::floor(v + 0.5));
+}
+
+// 解析 rgb(...) / rgba(...)，支持空格。两种语法：
+// - 逗号分隔：rgb(255, 0, 0) / rgba(255, 0, 0, 0.5)
+// - CSS Color 4 空格分隔：rgb(255 0 0) / rgb(100% 0% 0% / 50%)
+// 通道可为数字或百分比；alpha 只做校验，结果忽略。
+// 逐字符扫描实现，不再每次调用都编译 std::regex。
+static bool parseRgbFunc(std::string_view val, RGB& out) {
+    CssScanner sc{ val.data(), val.data() + val.size() };
+    if (!sc.eatWord("rgb")) return false;
+    sc.eatWord("a");
+    if (!sc.eat('(')) return false;
+
+    double v[3];
+    bool pct[3];
+    bool commas = false;
+    for (int i = 0; i < 3; ++i) {
+        sc.skipWs();
+        if (!sc.number(v[i], pct[i])) return false;
+        bool spaced = sc.skipWs();
+        if (i == 0) commas = sc.eat(',');
+        else if (i == 1 && commas && !sc.eat(',')) return false;
+        // 空格语法下，相邻通道之间必须有空白
+        if (i < 2 && !commas && !spaced) return false;
+    }
+    if (commas ? sc.eat(',') : sc.eat('/')) {
+        double alpha;
+        bool alphaPct;
+        sc.skipWs();
+        if (!sc.number(alpha, alphaPct)) return false;
+        sc.skipWs();
+    }
+    if (!sc.eat(')') || sc.p != sc.end) return false;
+    out = RGB{ cssChannel(v[0], pct[0]), cssChannel(v[1], pct[1]), cssChannel(v[2], pct[2]), 255 };
+    return true;
+}
+
+// CSS/SVG 全部 148 个命名色（CSS Color 4，含 grey 拼写变体与 rebeccapurple）
+struct NamedColor { std::string_view name; RGB rgb; };
+constexpr NamedColor kNamedColors[] = {
+    {"aliceblue",{240,248,255,255}}, {"antiquewhite",{250,235,215,255}}, {"aqua",{0,255,255,255}},
+    {"aquamarine",{127,255,212,255}}, {"azure",{240,255,255,255}}, {"beige",{245,245,220,255}},
+    {"bisque",{255,228,196,255}}, {"black",{0,0,0,255}}, {"blanchedalmond",{255,235,205,255}},
+    {"blue",{0,0,255,255}}, {"blueviolet",{138,43,226,255}}, {"brown",{165,42,42,255}},
+    {"burlywood",{222,184,135,255}}, {"cadetblue",{95,158,160,255}}, {"chartreuse",{127,255,0,255}},
+    {"chocolate",{210,105,30,255}}, {"coral",{255,127,80,255}}, {"cornflowerblue",{100,149,237,255}},
+    {"cornsilk",{255,248,220,255}}, {"crimson",{220,20,60,255}}, {"cyan",{0,255,255,255}},
+    {"darkblue",{0,0,139,255}}, {"darkcyan",{0,139,139,255}}, {"darkgoldenrod",{184,134,11,255}},
+    {"darkgray",{169,169,169,255}}, {"darkgreen",{0,100,0,255}}, {"darkgrey",{169,169,169,255}},
+    {"darkkhaki",{189,183,107,255}}, {"darkmagenta",{139,0,139,255}}, {"darkolivegreen",{85,107,47,255}},
+    {"darkorange",{255,140,0,255}}, {"darkorchid",{153,50,204,255}}, {"darkred",{139,0,0,255}},
+    {"darksalmon",{233,150,122,255}}, {"darkseagreen",{143,188,143,255}}, {"darkslateblue",{72,61,139,255}},
+    {"darkslategray",{47,79,79,255}}, {"darkslategrey",{47,79,79,255}}, {"darkturquoise",{0,206,209,255}},
+    {"darkviolet",{148,0,211,255}}, {"deeppink",{255,20,147,255}}, {"deepskyblue",{0,191,255,255}},
+    {"dimgray",{105,105,105,255}}, {"dimgrey",{105,105,105,255}}, {"dodgerblue",{30,144,255,255}},
+    {"firebrick",{178,34,34,255}}, {"floralwhite",{255,250,240,255}}, {"forestgreen",{34,139,34,255}},
+    {"fuchsia",{255,0,255,255}}, {"gainsboro",{220,220,220,255}}, {"ghostwhite",{248,248,255,255}},
+    {"gold",{255,215,0,255}}, {"goldenrod",{218,165,32,255}}, {"gray",{128,128,128,255}},
+    {"green",{0,128,0,255}}, {"greenyellow",{173,255,47,255}}, {"grey",{128,128,128,255}},
+    {"honeydew",{240,255,240,255}}, {"hotpink",{255,105,180,255}}, {"indianred",{205,92,92,255}},
+    {"indigo",{75,0,130,255}}, {"ivory",{255,255,240,255}}, {"khaki",{240,230,140,255}},
+    {"lavender",{230,230,250,255}}, {"lavenderblush",{255,240,245,255}}, {"lawngreen",{124,252,0,255}},
+    {"lemonchiffon",{255,250,205,255}}, {"lightblue",{173,216,230,255}}, {"lightcoral",{240,128,128,255}},
+    {"lightcyan",{224,255,255,255}}, {"lightgoldenrodyellow",{250,250,210,255}},
+    {"lightgray",{211,211,211,255}}, {"lightgreen",{144,238,144,255}}, {"lightgrey",{211,211,211,255}},
+    {"lightpink",{255,182,193,255}}, {"lightsalmon",{255,160,122,255}}, {"lightseagreen",{32,178,170,255}},
+    {"lightskyblue",{135,206,250,255}}, {"lightslategray",{119,136,153,255}},
+    {"lightslategrey",{119,136,153,255}}, {"lightsteelblue",{176,196,222,255}},
+    {"lightyellow",{255,255,224,255}}, {"lime",{0,255,0,255}}, {"limegreen",{50,205,50,255}},
+    {"linen",{250,240,230,255}}, {"magenta",{255,0,255,255}}, {"maroon",{128,0,0,255}},
+    {"mediumaquamarine",{102,205,170,255}}, {"mediumblue",{0,0,205,255}}, {"mediumorchid",{186,85,211,255}},
+    {"mediumpurple",{147,112,219,255}}, {"mediumseagreen",{60,179,113,255}},
+    {"mediumslateblue",{123,104,238,255}}, {"mediumspringgreen",{0,250,154,255}},
+    {"mediumturquoise",{72,209,204,255}}, {"mediumvioletred",{199,21,133,255}},
+    {"midnightblue",{25,25,112,255}}, {"mintcream",{245,255,250,255}}, {"mistyrose",{255,228,225,255}},
+    {"moccasin",{255,228,181,255}}, {"navajowhite",{255,222,173,255}}, {"navy",{0,0,128,255}},
+    {"oldlace",{253,245,230,255}}, {"olive",{128,128,0,255}}, {"olivedrab",{107,142,35,255}},
+    {"orange",{255,165,0,255}}, {"orangered",{255,69,0,255}}, {"orchid",{218,112,214,255}},
+    {"palegoldenrod",{238,232,170,255}}, {"palegreen",{152,251,152,255}},
+    {"paleturquoise",{175,238,238,255}}, {"palevioletred",{219,112,147,255}},
+    {"papayawhip",{255,239,213,255}}, {"peachpuff",{255,218,185,255}}, {"peru",{205,133,63,255}},
+    {"pink",{255,192,203,255}}, {"plum",{221,160,221,255}}, {"powderblue",{176,224,230,255}},
+    {"purple",{128,0,128,255}}, {"rebeccapurple",{102,51,153,255}}, {"red",{255,0,0,255}},
+    {"rosybrown",{188,143,143,255}}, {"royalblue",{65,105,225,255}}, {"saddlebrown",{139,69,19,255}},
+    {"salmon",{250,128,114,255}}, {"sandybrown",{244,164,96,255}}, {"seagreen",{46,139,87,255}},
+    {"seashell",{255,245,238,255}}, {"sienna",{160,82,45,255}}, {"silver",{192,192,192,255}},
+    {"skyblue",{135,206,235,255}}, {"slateblue",{106,90,205,255}}, {"slategray",{112,128,144,255}},
+    {"slategrey",{112,128,144,255}}, {"snow",{255,250,250,255}}, {"springgreen",{0,255,127,255}},
+    {"steelblue",{70,130,180,255}}, {"tan",{210,180,140,255}}, {"teal",{0,128,128,255}},
+    {"thistle",{216,191,216,255}}, {"tomato",{255,99,71,255}}, {"turquoise",{64,224,208,255}},
+    {"violet",{238,130,238,255}}, {"wheat",{245,222,179,255}}, {"white",{255,255,255,255}},
+    {"whitesmoke",{245,245,245,255}}, {"yellow",{255,255,0,255}}, {"yellowgreen",{154,205,50,255}}
+};
+
+// 编译期完美哈希：大小写不敏感的 FNV-1a（种子离线搜得），1024 槽位内 148 个名字互不冲突。
+// 槽位存“下标 + 1”，0 表示空；命中后再比对一次名字以排除非命名色输入。
+constexpr uint32_t kNamedColorSeed = 0x811E7328u;
+constexpr size_t kNamedColorSlots = 1024;
+constexpr size_t kNamedColorMaxLen = 20; // lightgoldenrodyellow
+
+constexpr uint32_t namedColorHash(std::string_view s) {
+    uint32_t h = kNamedColorSeed;
+    for (char c : s) {
+        h ^= static_cast<uint8_t>(asciiLower(c));
+        h *= 16777619u;
+    }
+    return h ^ (h >> 16);
+}
+
+struct NamedColorIndex {
+    uint8_t slot[kNamedColorSlots];
+    bool perfect;
+};
+
+constexpr NamedColorIndex buildNamedColorIndex() {
+    NamedColorIndex index{};
+    index.perfect = true;
+    for (size_t i = 0; i < std::size(kNamedColors); ++i) {
+        uint8_t& slot = index.slot[namedColorHash(kNamedColors[i].name) & (kNamedColorSlots - 1)];
+        if (slot != 0) index.perfect = false;
+        slot = static_cast<uint8_t>(i + 1);
+    }
+    return index;
+}
+
+constexpr NamedColorIndex kNamedColorIndex = buildNamedColorIndex();
+static_assert(std::size(kNamedColors) == 148, "CSS 命名色应为 148 个");
+static_assert(kNamedColorIndex.perfect, "命名色哈希出现冲突，请重新搜索 kNamedColorSeed");
+
+// 命名色查表：一次哈希 + 一次比对，大小写不敏感，不分配内存
+static bool parseNamedColor(std::string_view val, RGB& out) {
+    val = trim(val);
+    if (val.size() < 3 || val.size() > kNamedColorMaxLen) return false;
+    uint8_t slot = kNamedColorIndex.slot[namedColorHash(val) & (kNamedColorSlots - 1)];
+    if (slot == 0 || !iequals(val, kNamedColors[slot - 1].name)) return false;
+    out = kNamedColors[slot - 1].rgb;
+    return true;
+}
+
+// 统一入口：把颜色字符串解析成 RGB（支持 #hex / rgb(...) / 命名色）
+// 遇到 "none"、"transparent"、"currentColor"、"url(#...)" 直接返回 false（不处理）
+static bool parseColorString(std::string_view raw, RGB& out) {
+    std::string_view s = trim(raw);
+    if (s.empty()) return false;
+    if (iequals(s, "none") || iequals(s, "transparent") || iequals(s, "currentcolor")) return false;
+    if (istartsWith(s, "url(")) return false; // 渐变/引用，跳过
+    RGB rgb;
+    if (parseHexColor(s, rgb)) { out = rgb; return true; }
+    if (parseRgbFunc(s, rgb)) { out = rgb; return true; }
+    if (parseNamedColor(s, rgb)) { out = rgb; return true; }
+    return false;
+}
+
+// 反转亮度：输入颜色字符串 -> 写出新的十六进制颜色（统一为 #RRGGBB）
+bool invertColorString(std::string_view in, char (&outHex)[8]) {
+    RGB rgb;
+    if (!parseColorString(in, rgb)) return false;
+    rgbToHex(g_inversionMode == InversionMode::Integer ? invertRgbInteger(rgb) : invertRgbExact(rgb), outHex);
+    return true;
+}
+
+// ------------------- 颜色解析校验 --------------------------
+
+// 旧版 rgb() 解析器，逐字保留作为对照：新扫描器对它接受的每个输入都必须给出相同的 RGB
+static bool parseRgbFuncLegacy(const std::string& val, RGB& out) {
+    static const std::regex re(R"(rgba?\(\s*([0-9]{1,3})\s*,\s*([0-9]{1,3})\s*,\s*([0-9]{1,3})(?:\s*,\s*([0-9]*\.?[0-9]+|[0-9]{1,3}%))?\s*\))",
+        std::regex::icase);
+    std::smatch m;
+    if (!std::regex_match(val, m, re)) return false;
+    int r = std::min(255, std::max(0, std::stoi(m[1].str())));
+    int g = std::min(255, std::max(0, std::stoi(m[2].str())));
+    int b = std::min(255, std::max(0, std::stoi(m[3].str())));
+    out = RGB{ uint8_t(r), uint8_t(g), uint8_t(b), 255 };
+    return true;
+}
+
+// 按 rgb() 语法拼出一个样例，再随机做 0..2 次单字符变异（删除 / 插入 / 替换）
+static std::string randomRgbString(std::mt19937& rng) {
+    auto chance = [&](int percent) { return int(rng() % 100) < percent; };
+    auto pick = [&](std::initializer_list<const char*> items) { return items.begin()[rng() % items.size()]; };
+    auto number = [&]() {
+        std::string n;
+        if (chance(5)) n += pick({ "+", "-" });
+        int digits = chance(10) ? 0 : 1 + int(rng() % 4);
+        for (int i = 0; i < digits; ++i) n += char('0' + rng() % 10);
+        if (chance(15)) {
+            n += '.';
+            for (int i = int(rng() % 3); i > 0; --i) n += char('0' + rng() % 10);
+        }
+        if (chance(15)) n += '%';
+        return n;
+    };
+    auto ws = [&]() { return std::string(pick({ "", "", " ", "  ", "\t", "\n " })); };
+
+    std::string s = pick({ "rgb(", "rgba(", "RGB(", "Rgba(", "rgb (", "rgbb(", "(" });
+    bool commas = chance(70);
+    for (int i = 0; i < 3; ++i) {
+        s += ws() + number() + ws();
+        if (i < 2) s += commas ? (chance(95) ? "," : "") : (chance(90) ? " " : "");
+    }
+    if (chance(40)) s += std::string(commas ? "," : "/") + ws() + number() + ws();
+    if (chance(95)) s += ")";
+    if (chance(5)) s += pick({ " ", ";", "x" });
+
+    static const char kAlphabet[] = "rgbaRGBA(),/%.+- \t0123456789";
+    for (int k = int(rng() % 3); k > 0 && !s.empty(); --k) {
+        size_t at = rng() % s.size();
+        char c = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+        switch (rng() % 3) {
+        case 0: s.erase(at, 1); break;
+        case 1: s.insert(s.begin() + at, c); break;
+        default: s[at] = c; break;
+        }
+    }
+    return s;
+}
+
+ColorParserCheck verifyColorParser(uint32_t seed, size_t cases) {
+    ColorParserCheck res;
+    auto fail = [&](const std::string& input) {
+        if (res.firstFailure.empty()) res.firstFailure = input;
+    };
+    std::mt19937 rng(seed);
+    for (size_t i = 0; i < cases; ++i) {
+        std::string s = randomRgbString(rng);
+        RGB legacy{}, scanned{};
+        bool oldOk = parseRgbFuncLegacy(s, legacy);
+        bool newOk = parseRgbFunc(s, scanned);
+        ++res.checked;
+        if (oldOk) {
+            ++res.legacyAccepted;
+            if (!newOk || legacy.r != scanned.r || legacy.g != scanned.g || legacy.b != scanned.b) {
+                ++res.mismatched;
+                fail(s);
+            }
+        }
+        else if (newOk) {
+            ++res.extended;
+        }
+    }
+
+    // 旧解析器不接受的 CSS Color 4 写法：百分比、小数、空格分隔、/ alpha，超界钳位后四舍五入
+    struct Golden { const char* input; bool ok; uint8_t r, g, b; };
+    static const Golden kGolden[] = {
+        { "rgb(255 0 0)", true, 255, 0, 0 },
+        { "rgb(100% 0% 50% / 0.5)", true, 255, 0, 128 },
+        { "rgba(12.5, 0.4, 254.5)", true, 13, 0, 255 },
+        { "rgb(-20, 300, 1e2)", false, 0, 0, 0 },
+        { "rgb(-20, 300, 100)", true, 0, 255, 100 },
+        { "rgb(150% -5% 33.3%)", true, 255, 0, 85 },
+        { "RGB( 1 2 3 / 40% )", true, 1, 2, 3 },
+        { "rgb(1 2, 3)", false, 0, 0, 0 },
+        { "rgb(1,2 3)", false, 0, 0, 0 },
+        { "rgb(1 2 3 4)", false, 0, 0, 0 },
+        { "rgb(1, 2, 3 / 0.5)", false, 0, 0, 0 },
+        { "rgb(.5 0 0)", true, 1, 0, 0 },
+        { "rgb(. 0 0)", false, 0, 0, 0 },
+    };
+    for (const Golden& g : kGolden) {
+        RGB rgb{};
+        bool ok = parseRgbFunc(g.input, rgb);
+        if (ok != g.ok || (ok && (rgb.r != g.r || rgb.g != g.g || rgb.b != g.b))) {
+            ++res.goldenFailed;
+            fail(g.input);
+        }
+    }
+    return res;
+}
+
+// ------------------- SVG 颜色反转缓存 --------------------------
+static std::atomic<uint64_t> g_colorCacheHits{ 0 }, g_colorCacheMisses{ 0 };
+
+void ColorInversionCache::flushStats() {
+    g_colorCacheHits += hits_;
+    g_colorCacheMisses += misses_;
+    hits_ = misses_ = 0;
+}
+
+// ------------------- SVG 处理 --------------------------
+
+// 需要处理的颜色型属性（可自行扩展）
+static const char* kColorAttrs[] = {
+    "fill", "stroke", "stop-color", "flood-color", "lighting-color", "color",
+    "customFrame" // 你这份 SVG 里出现了这个自定义字段
+};
+
+static bool isColorAttrName(std::string_view name) {
+    for (const char* k : kColorAttrs) {
+        if (name == k) return true;
+    }
+    return false;
+}
+
+// 简单解析 style="a:b; c:d;"，只改与颜色相关的键，结果写入 out（先清空）
+// 注意：这里不处理复合的 CSS 选择器或变量；够覆盖常见 SVG 图标
+static void rewriteStyleValue(std::string_view s, ColorInversionCache& cache, std::string& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < s.size()) {
+        // 取 key
+        size_t keyBeg = i;
+        size_t colon = s.find(':', i);
+        if (colon == std::string_view::npos) { out.append(s.substr(i)); break; }
+        std::string_view key = trim(s.substr(keyBeg, colon - keyBeg));
+        // 取 value
+        size_t semi = s.find(';', colon + 1);
+        std::string_view val = trim(s.substr(colon + 1, (semi == std::string_view::npos ? s.size() : semi) - (colon + 1)));
+
+        // 是否颜色键
+        bool isColorKey = false;
+        for (const char* k : kColorAttrs) {
+            if (iequals(key, k)) { isColorKey = true; break; }
+        }
+
+        char newHex[8];
+        if (isColorKey && cache.invert(val, newHex)) {
+            val = newHex; // 替换为 #RRGGBB
+        }
+
+        // 还原
+        out.append(key);
+        out.append(": ");
+        out.append(val);
+        if (semi != std::string_view::npos) {
+            out.push_back(';');
+            i = semi + 1;
+        }
+        else {
+            i = s.size();
+        }
+    }
+}
+
+// 流式模式用的 style 改写：逐字节保留原文（空白、大小写、分号后的空格都不动），
+// 只把能成功反转的颜色键的值区间（去掉首尾空白后）替换为 #RRGGBB
+static void patchStyleValue(std::string_view s, ColorInversionCache& cache, std::string& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t colon = s.find(':', i);
+        if (colon == std::string_view::npos) { out.append(s.substr(i)); break; }
+        size_t semi = s.find(';', colon + 1);
+        size_t declEnd = semi == std::string_view::npos ? s.size() : semi + 1;
+        std::string_view key = trim(s.substr(i, colon - i));
+        size_t valBeg = colon + 1;
+        size_t valEnd = semi == std::string_view::npos ? s.size() : semi;
+        while (valBeg < valEnd && isTrimSpace(s[valBeg])) ++valBeg;
+        while (valEnd > valBeg && isTrimSpace(s[valEnd - 1])) --valEnd;
+
+        // CSS 属性名不区分大小写，与 DOM 模式一致
+        bool isColorKey = false;
+        for (const char* k : kColorAttrs) {
+            if (iequals(key, k)) { isColorKey = true; break; }
+        }
+
+        char newHex[8];
+        if (isColorKey && cache.invert(s.substr(valBeg, valEnd - valBeg), newHex)) {
+            out.append(s.substr(i, valBeg - i));
+            out.append(newHex);
+            out.append(s.substr(valEnd, declEnd - valEnd));
+        }
+        else {
+            out.append(s.substr(i, declEnd - i));
+        }
+        i = declEnd;
+    }
+}
+
+// SVG 处理方式：
+// - Dom    : tinyxml2 载入整棵 DOM 后改写属性再序列化（会重新排版输出）
+// - Stream : 单遍扫描原始字节，只替换颜色属性与 style 的值，其余内容逐字节原样拷贝
+static SvgMode g_svgMode = SvgMode::Dom;
+
+void setSvgMode(SvgMode mode) { g_svgMode = mode; }
+SvgMode svgMode() { return g_svgMode; }
+
+// 流式改写：不建 DOM、不走 tinyxml2 的节点池。
+// 识别注释、CDATA、处理指令、DOCTYPE（含内部子集）与结束标签并原样跳过；
+// 只在开始标签内解析属性。含实体引用（&...;）的属性值保持原样，不做解码。
+// 遇到未闭合的结构时，把剩余字节原样拷贝并结束。
+static void rewriteSvgStream(std::string_view in, std::string& out) {
+    ColorInversionCache& cache = ColorInversionCache::local();
+    thread_local std::string style;
+    out.clear();
+    out.reserve(in.size() + 64);
+
+    auto startsAt = [&](size_t pos, std::string_view token) { return in.compare(pos, token.size(), token) == 0; };
+    auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; };
+    // 把 [from, 直到 token 结束) 原样拷贝，返回新位置；找不到 token 时拷贝到末尾
+    auto copyThrough = [&](size_t from, std::string_view token) {
+        size_t end = in.find(token, from);
+        end = end == std::string_view::npos ? in.size() : end + token.size();
+        out.append(in.substr(from, end - from));
+        return end;
+        };
+
+    size_t i = 0, n = in.size();
+    while (i < n) {
+        size_t lt = in.find('<', i);
+        if (lt == std::string_view::npos) { out.append(in.substr(i)); break; }
+        out.append(in.substr(i, lt - i));
+        if (startsAt(lt, "<!--")) { i = copyThrough(lt, "-->"); continue; }
+        if (startsAt(lt, "<![CDATA[")) { i = copyThrough(lt, "]]>"); continue; }
+        if (startsAt(lt, "<?")) { i = copyThrough(lt, "?>"); continue; }
+        if (startsAt(lt, "</")) { i = copyThrough(lt, ">"); continue; }
+        if (startsAt(lt, "<!")) {
+            // DOCTYPE：跳过引号与 [...] 内部子集中的 '>'
+            size_t j = lt + 2;
+            int depth = 0;
+            char quote = 0;
+            for (; j < n; ++j) {
+                char c = in[j];
+                if (quote) { if (c == quote) quote = 0; }
+                else if (c == '"' || c == '\'') quote = c;
+                else if (c == '[') ++depth;
+                else if (c == ']') --depth;
+                else if (c == '>' && depth <= 0) { ++j; break; }
+            }
+            out.append(in.substr(lt, j - lt));
+            i = j;
+            continue;
+        }
+
+        // 开始标签：先拷贝 '<' 与标签名
+        size_t j = lt + 1;
+        while (j < n && !isSpace(in[j]) && in[j] != '>' && in[j] != '/') ++j;
+        out.append(in.substr(lt, j - lt));
+        while (j < n) {
+            size_t ws = j;
+            while (j < n && isSpace(in[j])) ++j;
+            out.append(in.substr(ws, j - ws));
+            if (j >= n) break;
+            if (in[j] == '>') { out.push_back('>'); ++j; break; }
+            if (in[j] == '/') { out.push_back('/'); ++j; continue; }
+
+            // 属性名
+            size_t nameBeg = j;
+            while (j < n && !isSpace(in[j]) && in[j] != '=' && in[j] != '>' && in[j] != '/') ++j;
+            std::string_view name = in.substr(nameBeg, j - nameBeg);
+            while (j < n && isSpace(in[j])) ++j;
+            if (j >= n || in[j] != '=') {
+                // 无值属性（不合法，但照样透传）
+                out.append(in.substr(nameBeg, j - nameBeg));
+                continue;
+            }
+            ++j;
+            while (j < n && isSpace(in[j])) ++j;
+            if (j >= n || (in[j] != '"' && in[j] != '\'')) {
+                out.append(in.substr(nameBeg, j - nameBeg));
+                continue;
+            }
+            char quote = in[j];
+            size_t valBeg = j + 1;
+            size_t valEnd = in.find(quote, valBeg);
+            if (valEnd == std::string_view::npos) valEnd = n;
+            std::string_view val = in.substr(valBeg, valEnd - valBeg);
+            // 名字、'='、引号原样拷贝
+            out.append(in.substr(nameBeg, valBeg - nameBeg));
+
+            char newHex[8];
+            bool plain = val.find('&') == std::string_view::npos;
+            if (plain && isColorAttrName(name) && cache.invert(val, newHex)) {
+                out.append(newHex);
+            }
+            else if (plain && name == "style") {
+                patchStyleValue(val, cache, style);
+                out.append(style);
+            }
+            else {
+                out.append(val);
+            }
+            if (valEnd < n) out.push_back(quote);
+            j = valEnd + 1;
+        }
+        i = std::min(j, n);
+    }
+    cache.flushStats();
+}
+
+// 内存到内存的 SVG 改写，按 g_svgMode 选择流式或 DOM；解析失败返回 false
+static bool transformSvg(std::string_view in, std::string& out) {
+    if (g_svgMode == SvgMode::Stream) {
+        // 单趟扫描，解析与反转无法拆开，整体计入反转
+        StageTimer timer(Stage::Invert);
+        rewriteSvgStream(in, out);
+        return true;
+    }
+
+    // 直接 Parse 内存中的文本，不经 tinyxml2 的 LoadFile
+    XMLDocument doc;
+    {
+        StageTimer timer(Stage::XmlParse);
+        if (doc.Parse(in.data(), in.size()) != XML_SUCCESS) return false;
+    }
+
+    ColorInversionCache& cache = ColorInversionCache::local();
+
+    auto tryProcessAttr = [&](XMLElement* elem, const char* attrName) {
+        const char* val = elem->Attribute(attrName);
+        if (!val) return;
+        char newHex[8];
+        if (cache.invert(val, newHex)) {
+            elem->SetAttribute(attrName, newHex);
+        }
+        };
+
+    // 输出缓冲按线程复用，稳定后不再触发堆分配
+    thread_local std::string styleOut;
+    auto processStyleAttr = [&](XMLElement* elem) {
+        const char* style = elem->Attribute("style");
+        if (!style) return;
+        rewriteStyleValue(style, cache, styleOut);
+        elem->SetAttribute("style", styleOut.c_str());
+        };
+
+    std::function<void(XMLElement*)> traverse = [&](XMLElement* e) {
+        // 1) 直接属性
+        for (const char* name : kColorAttrs) {
+            tryProcessAttr(e, name);
+        }
+        // 2) style 属性里的颜色
+        processStyleAttr(e);
+        // 3) 递归子元素
+        for (XMLElement* c = e->FirstChildElement(); c; c = c->NextSiblingElement()) {
+            traverse(c);
+        }
+        };
+
+    StageTimer invertTimer(Stage::Invert);
+    traverse(doc.RootElement());
+    cache.flushStats();
+    invertTimer.stop();
+    // 与 SaveFile 相同的打印器与格式，只是输出到内存
+    StageTimer encodeTimer(Stage::Encode);
+    XMLPrinter printer;
+    doc.Print(&printer);
+    out.assign(printer.CStr(), static_cast<size_t>(printer.CStrSize() - 1));
+    return true;
+}
+
+// ------------------- 编码档位 --------------------------
+
+// 输出编码在速度与体积之间的取舍（PNG 为无损，只影响耗时与体积；JPEG 质量固定为 95，只有 Small 改变编码方式）：
+// - Fast     : PNG 压缩级别 1 + RLE 策略，JPEG 质量 95（即 OpenCV 不传参数时的行为，默认）
+// - Balanced : PNG 级别 6 + 默认策略，JPEG 质量 95
+// - Small    : PNG 级别 9 + FILTERED 策略，JPEG 质量 95 并开启哈夫曼表优化与渐进式编码
+static EncodeProfile g_encodeProfile = EncodeProfile::Fast;
+
+// 按输出扩展名生成 cv::imwrite / cv::imencode 的参数
+static std::vector<int> imageWriteParams(const std::string& ext) {
+    if (ext == ".png") {
+        switch (g_encodeProfile) {
+        case EncodeProfile::Fast:
+            return { cv::IMWRITE_PNG_COMPRESSION, 1, cv::IMWRITE_PNG_STRATEGY, cv::IMWRITE_PNG_STRATEGY_RLE };
+        case EncodeProfile::Balanced:
+            return { cv::IMWRITE_PNG_COMPRESSION, 6, cv::IMWRITE_PNG_STRATEGY, cv::IMWRITE_PNG_STRATEGY_DEFAULT };
+        case EncodeProfile::Small:
+            return { cv::IMWRITE_PNG_COMPRESSION, 9, cv::IMWRITE_PNG_STRATEGY, cv::IMWRITE_PNG_STRATEGY_FILTERED };
+        }
+    }
+    if (ext == ".jpg" || ext == ".jpeg") {
+        // 各档位质量都是 95，只有 Small 另开哈夫曼表优化与渐进式编码
+        switch (g_encodeProfile) {
+        case EncodeProfile::Fast:
+        case EncodeProfile::Balanced:
+            return { cv::IMWRITE_JPEG_QUALITY, 95, cv::IMWRITE_JPEG_OPTIMIZE, 0 };
+        case EncodeProfile::Small:
+            return { cv::IMWRITE_JPEG_QUALITY, 95, cv::IMWRITE_JPEG_OPTIMIZE, 1, cv::IMWRITE_JPEG_PROGRESSIVE, 1 };
+        }
+    }
+    return {};
+}
+
+// 按输出格式累计编码次数、耗时与输出字节数，批处理结束时打印，用于比较各档位
+enum class EncodeFormat { Png, Jpeg, Bmp, IcoPngBuiltin, IcoPngOpenCV, Count };
+
+struct EncodeStat {
+    std::atomic<uint64_t> count{ 0 }, nanos{ 0 }, bytes{ 0 };
+};
+
+static EncodeStat g_encodeStats[static_cast<int>(EncodeFormat::Count)];
+
+// 计时从构造开始，record() 时记入对应格式，同时计入“编码”阶段
+class EncodeTimer {
+public:
+    explicit EncodeTimer(EncodeFormat format) : format_(format), start_(std::chrono::steady_clock::now()) {}
+    void record(size_t outputBytes) const {
+        uint64_t ns = nanosSince(start_);
+        EncodeStat& st = g_encodeStats[static_cast<int>(format_)];
+        st.count += 1;
+        st.nanos += ns;
+        st.bytes += outputBytes;
+        addStageNanos(Stage::Encode, ns);
+    }
+private:
+    EncodeFormat format_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+static const char* encodeFormatName(EncodeFormat f) {
+    switch (f) {
+    case EncodeFormat::Png: return "PNG";
+    case EncodeFormat::Jpeg: return "JPEG";
+    case EncodeFormat::Bmp: return "BMP";
+    case EncodeFormat::IcoPngBuiltin: return "ICO 内 PNG (builtin)";
+    case EncodeFormat::IcoPngOpenCV: return "ICO 内 PNG (opencv)";
+    default: return "?";
+    }
+}
+
+// 打印并清零编码统计
+static void reportEncodeStats() {
+    bool header = false;
+    for (int i = 0; i < static_cast<int>(EncodeFormat::Count); ++i) {
+        EncodeStat& st = g_encodeStats[i];
+        uint64_t count = st.count.exchange(0), nanos = st.nanos.exchange(0), bytes = st.bytes.exchange(0);
+        if (count == 0) continue;
+        LogLine line(std::cout);
+        if (!header) {
+            line << "\n[编码耗时]\n";
+            header = true;
+        }
+        double ms = nanos / 1e6;
+        line << "  " << encodeFormatName(static_cast<EncodeFormat>(i)) << ": " << count << " 个，共 "
+            << ms << " ms，平均 " << ms / count << " ms，输出 " << bytes << " 字节\n";
+    }
+}
+
+// ICO 内嵌 PNG 的编解码方式：
+// - Builtin : 自带的 minipng 直接解出 RGBA 像素、反转后重新压缩，不经 cv::Mat / imdecode；
+//             非 8 位 RGBA 或非标准的 PNG 自动退回 OpenCV
+// - OpenCV  : 一律走 cv::imdecode / cv::imencode
+static IcoPngCodec g_icoPngCodec = IcoPngCodec::Builtin;
+static int g_icoPngLevel = 1; // 与默认的 Fast 档位一致
+
+void setIcoPngCodec(IcoPngCodec codec) { g_icoPngCodec = codec; }
+IcoPngCodec icoPngCodec() { return g_icoPngCodec; }
+void setIcoPngLevel(int level) { g_icoPngLevel = std::clamp(level, 0, 9); }
+
+// 切换编码档位；builtin PNG 的压缩级别随之取 1 / 6 / 9
+void setEncodeProfile(EncodeProfile profile) {
+    g_encodeProfile = profile;
+    g_icoPngLevel = profile == EncodeProfile::Fast ? 1 : profile == EncodeProfile::Small ? 9 : minipng::kDefaultLevel;
+}
+
+// 按种类生成 w x h 的 RGBA 合成图像，覆盖编码器的各条路径：
+// 噪声（几乎无匹配）、纯色与长重复（最长匹配与远距离匹配）、渐变（各过滤类型）、稀疏与少色块（短匹配与字面量混杂）
+static void syntheticRgba(int kind, uint32_t w, uint32_t h, std::mt19937& rng, std::vector<uint8_t>& px) {
+    px.assign(size_t(w) * h * 4, 0);
+    uint8_t palette[4][4];
+    for (auto& c : palette) for (uint8_t& v : c) v = uint8_t(rng());
+    for (uint32_t y = 0; y < h; ++y) {
+        for (uint32_t x = 0; x < w; ++x) {
+            uint8_t* p = &px[(size_t(y) * w + x) * 4];
+            switch (kind) {
+            case 0: for (int c = 0; c < 4; ++c) p[c] = uint8_t(rng()); break;
+            case 1: std::memcpy(p, palette[0], 4); break;
+            case 2: p[0] = uint8_t(x * 255 / std::max(1u, w - 1)); p[1] = uint8_t(y * 255 / std::max(1u, h - 1));
+                p[2] = uint8_t(x + y); p[3] = 255; break;
+            case 3: if (rng() % 16 == 0) { for (int c = 0; c < 3; ++c) p[c] = uint8_t(rng()); p[3] = uint8_t(rng()); } break;
+            case 4: std::memcpy(p, palette[((x / 3) ^ (y / 5)) & 3], 4); break;
+            default: std::memcpy(p, palette[rng() % 4], 4); if (rng() % 8 == 0) p[rng() % 4] ^= 1; break;
+            }
+        }
+    }
+}
+
+std::vector<PngRoundTripCheck> verifyPngRoundTrip(uint32_t seed) {
+    static const uint32_t kSizes[][2] = { { 1, 1 }, { 2, 3 }, { 7, 5 }, { 16, 16 }, { 31, 17 }, { 48, 48 }, { 64, 64 }, { 257, 129 } };
+    constexpr int kKinds = 6;
+    std::vector<PngRoundTripCheck> results(10);
+    minipng::Scratch scratch;
+    std::vector<uint8_t> pixels, png, decoded;
+    for (int level = 0; level <= 9; ++level) {
+        PngRoundTripCheck& res = results[level];
+        res.level = level;
+        std::mt19937 rng(seed); // 每个级别使用同一组图像
+        for (const auto& size : kSizes) {
+            for (int kind = 0; kind < kKinds; ++kind) {
+                syntheticRgba(kind, size[0], size[1], rng, pixels);
+                ++res.images;
+                res.rawBytes += pixels.size();
+                auto start = std::chrono::steady_clock::now();
+                bool encoded = minipng::encodeRgba8(pixels.data(), size[0], size[1], level, png, scratch);
+                res.nanos += nanosSince(start);
+                uint32_t w = 0, h = 0;
+                bool ok = encoded && minipng::decodeRgba8(png.data(), png.size(), w, h, decoded, scratch) &&
+                    w == size[0] && h == size[1] && decoded == pixels;
+                if (encoded) res.encodedBytes += png.size();
+                if (!ok && res.failed++ == 0) {
+                    std::ostringstream os;
+                    os << "种类 " << kind << "，" << size[0] << "x" << size[1] << "，" << (encoded ? "解码结果不一致" : "编码失败");
+                    res.firstFailure = os.str();
+                }
+            }
+        }
+    }
+    return results;
+}
+
+// 调色板 PNG 的 PLTE 按 R、G、B 排列，交给与像素相同的内核
+static void invertPaletteEntries(uint8_t* rgb, size_t entries) {
+    invertPixels(rgb, 1, static_cast<int>(entries), entries * 3, CV_8U, 3, ChannelOrder::Rgb);
+}
+
+// 调色板 PNG 只反转 PLTE 中的颜色：像素索引与 tRNS 原样保留，输出仍是调色板 PNG，
+// 工作量只与调色板大小有关，也不会像解码成真彩色再编码那样把文件撑大几倍。
+// 不是调色板 PNG 时返回 false，由调用方走常规路径
+static bool invertPalettePng(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    auto start = std::chrono::steady_clock::now();
+    if (!minipng::rewritePalette(data, size, &invertPaletteEntries, out)) return false;
+    addStageNanos(Stage::Invert, nanosSince(start));
+    return true;
+}
+
+// 用 minipng 就地反转一个 PNG 条目，成功时把新 PNG 写入 out
+static bool invertPngBuiltin(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    // 每个工作线程复用自己的缓冲，批量处理时不反复分配
+    thread_local minipng::Scratch scratch;
+    thread_local std::vector<uint8_t> pixels;
+    uint32_t width = 0, height = 0;
+    {
+        StageTimer timer(Stage::Decode);
+        if (!minipng::decodeRgba8(data, size, width, height, pixels, scratch)) return false;
+    }
+    StageTimer invertTimer(Stage::Invert);
+    invertPixels(pixels.data(), static_cast<int>(height), static_cast<int>(width), size_t(width) * 4, CV_8U, 4, ChannelOrder::Rgb);
+    invertTimer.stop();
+    EncodeTimer timer(EncodeFormat::IcoPngBuiltin);
+    if (!minipng::encodeRgba8(pixels.data(), width, height, g_icoPngLevel, out, scratch)) return false;
+    timer.record(out.size());
+    return true;
+}
+
+// ICO 文件处理类，支持亮度反转
+class IcoProcessor {
+private:
+    std::vector<uint8_t> fileData;
+    IconDir header;
+    std::vector<IconDirEntry> entries;
+
+    // 每个条目处理后的图像数据：重新编码的 PNG 放在 replacement，
+    // 否则引用 fileData 中的原区段（BMP 像素已在原地改写）。越界条目 valid = false，buildIco 重建时丢弃。
+    struct EntryPayload {
+        bool valid = false;
+        size_t offset = 0, size = 0;
+        std::vector<uint8_t> replacement;
+    };
+    std::vector<EntryPayload> payloads;
+
+    size_t entryTableEnd() const { return sizeof(IconDir) + entries.size() * sizeof(IconDirEntry); }
+
+    // 按目录表初始化各条目的数据区段；防止 offset 指到文件头、条目表内，或超出文件尾
+    void collectPayloads() {
+        payloads.assign(entries.size(), EntryPayload{});
+        for (size_t i = 0; i < entries.size(); ++i) {
+            size_t offset = entries[i].imageOffset, size = entries[i].bytesInRes;
+            if (offset + size > fileData.size() || offset < entryTableEnd()) continue;
+            payloads[i].valid = true;
+            payloads[i].offset = offset;
+            payloads[i].size = size;
+        }
+    }
+
+    bool isPngAt(size_t offset) const {
+        if (fileData.size() < offset + 8) return false;
+        static const uint8_t pngSig[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        return std::memcmp(fileData.data() + offset, pngSig, 8) == 0;
+    }
+
+    bool tryRepairIco() {
+        // 先尝试 PNG
+        LogLine(std::cout) << "[Repair] 尝试自动修复损坏 ICO..." << std::endl;
+        // 1. 搜索 PNG
+        auto pngIt = std::search(fileData.begin(), fileData.end(),
+            "\x89PNG\r\n\x1A\n", "\x89PNG\r\n\x1A\n" + 8);
+        if (pngIt != fileData.end()) {
+            size_t pngOffset = std::distance(fileData.begin(), pngIt);
+            size_t pngLen = fileData.size() - pngOffset;
+            cv::Mat tmp = cv::imdecode(cv::Mat(1, static_cast<int>(pngLen), CV_8UC1, fileData.data() + pngOffset), cv::IMREAD_UNCHANGED);
+            if (!tmp.empty()) {
+                // 重组 ICO
+                IconDir newHeader{ 0, 1, 1 };
+                IconDirEntry newEntry{};
+                newEntry.width = static_cast<uint8_t>(tmp.cols);
+                newEntry.height = static_cast<uint8_t>(tmp.rows);
+                newEntry.colorCount = 0;
+                newEntry.reserved = 0;
+                newEntry.planes = 1;
+                newEntry.bitCount = 32;
+                newEntry.bytesInRes = static_cast<uint32_t>(pngLen);
+                newEntry.imageOffset = sizeof(IconDir) + sizeof(IconDirEntry);
+
+                fileData.resize(sizeof(IconDir) + sizeof(IconDirEntry) + pngLen);
+                std::memcpy(fileData.data(), &newHeader, sizeof(IconDir));
+                std::memcpy(fileData.data() + sizeof(IconDir), &newEntry, sizeof(IconDirEntry));
+                std::memcpy(fileData.data() + sizeof(IconDir) + sizeof(IconDirEntry),
+                    fileData.data() + pngOffset, pngLen);
+
+                header = newHeader;
+                entries.clear();
+                entries.push_back(newEntry);
+                LogLine(std::cout) << "[Repair] ICO 修复成功，已提取单一 32 位 PNG 图标\n";
+                return true;
+            }
+        }
+        // 2. 搜索 BMP/DIB 32位图
+        for (size_t offset = 0; offset + sizeof(BitmapInfoHeader) < fileData.size(); offset++) {
+            const BitmapInfoHeader* bih = reinterpret_cast<const BitmapInfoHeader*>(fileData.data() + offset);
+            if (bih->size == 40 && bih->width > 0 && bih->height > 0 &&
+                (bih->bitCount == 32 || bih->bitCount == 24) &&
+                bih->planes == 1) {
+                // 计算像素块大小，ICO 的 DIB 是 height*2，后面有 AND mask
+                int width = bih->width;
+                int height = bih->height / 2;
+                size_t dibSize = sizeof(BitmapInfoHeader) + width * height * (bih->bitCount / 8);
+                // 容错：不越界
+                if (offset + dibSize > fileData.size()) continue;
+                // 可解码，生成新的 ICO
+                IconDir newHeader{ 0, 1, 1 };
+                IconDirEntry newEntry{};
+                newEntry.width = static_cast<uint8_t>(width);
+                newEntry.height = static_cast<uint8_t>(height);
+                newEntry.colorCount = 0;
+                newEntry.reserved = 0;
+                newEntry.planes = 1;
+                newEntry.bitCount = bih->bitCount;
+                newEntry.bytesInRes = static_cast<uint32_t>(dibSize);
+                newEntry.imageOffset = sizeof(IconDir) + sizeof(IconDirEntry);
+
+                // 新数据
+                std::vector<uint8_t> newFile(sizeof(IconDir) + sizeof(IconDirEntry) + dibSize);
+                std::memcpy(newFile.data(), &newHeader, sizeof(IconDir));
+                std::memcpy(newFile.data() + sizeof(IconDir), &newEntry, sizeof(IconDirEntry));
+                std::memcpy(newFile.data() + sizeof(IconDir) + sizeof(IconDirEntry),
+                    fileData.data() + offset, dibSize);
+
+                fileData = std::move(newFile);
+                header = newHeader;
+                entries.clear();
+                entries.push_back(newEntry);
+                LogLine(std::cout) << "[Repair] ICO 修复成功，已提取单一 32 位 BMP 图标\n";
+                return true;
+            }
+        }
+        LogLine(std::cerr) << "[Repair] 未找到有效 PNG 或 BMP 区块，修复失败\n";
+        return false;
+    }
+
+public:
+    bool loadIco(const fs::path& filename) {
+        MappedFile file(filename);
+        if (!file.isOpen()) return false;
+        return loadIco(file.data(), file.size());
+    }
+
+    // 从内存载入（数据由调用方持有，读入阶段与处理阶段分离时使用）
+    bool loadIco(const uint8_t* data, size_t size) {
+        // 目录解析与必要时的修复都算作容器解码
+        StageTimer timer(Stage::Decode);
+        if (size < sizeof(IconDir)) return false;
+        // 像素会被原地改写，这里保留一份可写副本（直接从映射页 / 输入缓冲拷贝，无流缓冲）
+        fileData.assign(data, data + size);
+        std::memcpy(&header, fileData.data(), sizeof(IconDir));
+        if (header.count == 0) return false;
+        entries.clear();
+        size_t entryTableEnd = sizeof(IconDir) + header.count * sizeof(IconDirEntry);
+        size_t validCount = 0;
+        if (entryTableEnd > size) {
+            size_t maxCount = (size > sizeof(IconDir)) ? (size - sizeof(IconDir)) / sizeof(IconDirEntry) : 0;
+            for (size_t i = 0; i < maxCount; ++i) {
+                IconDirEntry entry;
+                std::memcpy(&entry, fileData.data() + sizeof(IconDir) + i * sizeof(IconDirEntry), sizeof(IconDirEntry));
+                if (entry.imageOffset + entry.bytesInRes <= size)
+                    ++validCount;
+                entries.push_back(entry);
+            }
+        }
+        else {
+            for (size_t i = 0; i < header.count; ++i) {
+                IconDirEntry entry;
+                std::memcpy(&entry, fileData.data() + sizeof(IconDir) + i * sizeof(IconDirEntry), sizeof(IconDirEntry));
+                if (entry.imageOffset + entry.bytesInRes <= size)
+                    ++validCount;
+                entries.push_back(entry);
+            }
+        }
+        if (entries.empty() || validCount == 0) {
+            LogLine(std::cerr) << "[Warning] ICO 条目无效，尝试修复...\n";
+            if (!tryRepairIco()) {
+                LogLine(std::cerr) << "[Error] ICO 修复失败，彻底跳过\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+	void processHslInversion() {
+        bool hasValidImage = false; // 统计至少有1个 entry 能处理
+        collectPayloads();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            EntryPayload& payload = payloads[i];
+            if (!payload.valid) {
+                LogLine(std::cerr) << "[Warning] 图像数据超出范围，跳过第 " << i << " 个 ICO 图像\n";
+                continue;
+            }
+            size_t offset = payload.offset;
+            size_t sizeInRes = payload.size;
+            hasValidImage = true;
+
+            if (isPngAt(offset)) {
+                if (invertPalettePng(fileData.data() + offset, sizeInRes, payload.replacement)) {
+                    continue;
+                }
+                if (g_icoPngCodec == IcoPngCodec::Builtin &&
+                    invertPngBuiltin(fileData.data() + offset, sizeInRes, payload.replacement)) {
+                    continue;
+                }
+                // 直接在 fileData 上包 Mat 头解码，不再拷出临时 pngData
+                cv::Mat pngData(1, static_cast<int>(sizeInRes), CV_8UC1, fileData.data() + offset);
+                StageTimer decodeTimer(Stage::Decode);
+                cv::Mat img = cv::imdecode(pngData, cv::IMREAD_UNCHANGED);
+                decodeTimer.stop();
+                if (img.empty()) {
+                    LogLine(std::cerr) << "[Warning] PNG 解码失败, 跳过第 " << i << " 个\n";
+                    continue;
+                }
+                StageTimer invertTimer(Stage::Invert);
+                bool inverted = invertBrightness(img);
+                invertTimer.stop();
+                if (!inverted) {
+                    LogLine(std::cerr) << "[Warning] 不支持的 PNG 像素格式, 跳过第 " << i << " 个\n";
+                    continue;
+                }
+                // 新 PNG 不论比原数据大还是小，都存入 EntryPayload，由 buildIco 统一重排，不在 fileData 里原地腾挪
+                std::vector<uint8_t> outPng;
+                EncodeTimer timer(EncodeFormat::IcoPngOpenCV);
+                if (cv::imencode(".png", img, outPng, imageWriteParams(".png"))) {
+                    timer.record(outPng.size());
+                    payload.replacement = std::move(outPng);
+                }
+            }
+            else {
+                // BMP 逻辑
+                if (sizeInRes < sizeof(BitmapInfoHeader)) {
+                    LogLine(std::cerr) << "[Warning] BMP 数据过小，跳过第 " << i << " 个\n";
+                    continue;
+                }
+                BitmapInfoHeader bih;
+                std::memcpy(&bih, fileData.data() + offset, sizeof(BitmapInfoHeader));
+                if (bih.bitCount != 32) {
+                    LogLine(std::cerr) << "[Warning] 非32位BMP，跳过第 " << i << " 个\n";
+                    continue;
+                }
+                int width = bih.width;
+                int height = bih.height / 2;
+                if (width <= 0 || height <= 0) {
+                    LogLine(std::cerr) << "[Warning] BMP 尺寸无效，跳过第 " << i << " 个\n";
+                    continue;
+                }
+                size_t dataOffset = offset + sizeof(BitmapInfoHeader);
+                size_t available = offset + sizeInRes - dataOffset; // 只改本条目的数据区
+                size_t maxPixels = available / 4;
+                int safeHeight = std::min(height, static_cast<int>(maxPixels / width));
+                // 像素区连续存放（自底向上），逐像素变换与行序无关，整块当作一行处理即可
+                if (safeHeight > 0) {
+                    StageTimer timer(Stage::Invert);
+                    size_t count = size_t(safeHeight) * width;
+                    invertPixels(fileData.data() + dataOffset, 1, static_cast<int>(count), count * 4, CV_8U, 4, ChannelOrder::Bgr);
+                }
+            }
+        }
+        if (!hasValidImage) {
+            LogLine(std::cerr) << "[Info] 该 ICO 没有任何有效图像条目，仅跳过\n";
+        }
+    }
+
+    // 重建紧凑布局：文件头 + 目录表 + 依次紧密排列的图像数据。
+    // 先算出全部偏移与总大小，再一次性写入预分配好的缓冲区；越界条目从目录中剔除。
+    // 没有任何有效条目时原样输出 fileData。
+    void buildIco(std::vector<uint8_t>& out) {
+        StageTimer timer(Stage::Encode);
+        if (payloads.size() != entries.size()) collectPayloads();
+        size_t count = 0, total = sizeof(IconDir);
+        for (const EntryPayload& p : payloads) {
+            if (!p.valid) continue;
+            ++count;
+            total += sizeof(IconDirEntry) + (p.replacement.empty() ? p.size : p.replacement.size());
+        }
+        if (count == 0) {
+            out = fileData;
+            return;
+        }
+
+        out.resize(total);
+        IconDir outHeader = header;
+        outHeader.count = static_cast<uint16_t>(count);
+        std::memcpy(out.data(), &outHeader, sizeof(IconDir));
+        size_t dirPos = sizeof(IconDir);
+        size_t dataPos = sizeof(IconDir) + count * sizeof(IconDirEntry);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const EntryPayload& p = payloads[i];
+            if (!p.valid) continue;
+            const uint8_t* src = p.replacement.empty() ? fileData.data() + p.offset : p.replacement.data();
+            size_t len = p.replacement.empty() ? p.size : p.replacement.size();
+            IconDirEntry entry = entries[i];
+            entry.imageOffset = static_cast<uint32_t>(dataPos);
+            entry.bytesInRes = static_cast<uint32_t>(len);
+            std::memcpy(out.data() + dirPos, &entry, sizeof(IconDirEntry));
+            std::memcpy(out.data() + dataPos, src, len);
+            dirPos += sizeof(IconDirEntry);
+            dataPos += len;
+        }
+    }
+};
+
+// ------------------- 兜底自动修复 --------------------------
+
+/// OpenCV 兜底强解 ICO -> PNG -> 反色 -> 再自动打包为 ICO（只保留主图层），结果写入 out
+static bool recoverIcoViaImage(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    // 1. 尝试 OpenCV 强解 ICO（部分“伪ICO”其实直接是 PNG 数据）；按内容识别格式，直接解码输入内存
+    if (size == 0 || size > static_cast<size_t>(INT_MAX)) return false;
+    StageTimer decodeTimer(Stage::Decode);
+    cv::Mat img = cv::imdecode(cv::Mat(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data)), cv::IMREAD_UNCHANGED);
+    decodeTimer.stop();
+    if (img.empty()) return false;
+
+    // 2. 反色处理
+    StageTimer invertTimer(Stage::Invert);
+    bool inverted = invertBrightness(img); // alpha不变
+    invertTimer.stop();
+    if (!inverted) return false;
+
+    // 3. 打包为 ICO 格式（PNG嵌入法，通用兼容 Windows 7-11）
+    std::vector<uchar> pngBuf;
+    EncodeTimer timer(EncodeFormat::IcoPngOpenCV);
+    if (!cv::imencode(".png", img, pngBuf, imageWriteParams(".png"))) return false;
+    timer.record(pngBuf.size());
+    // 生成 ICO 结构
+    struct IconDir { uint16_t reserved, type, count; };
+    struct IconDirEntry {
+        uint8_t width, height, colorCount, reserved;
+        uint16_t planes, bitCount;
+        uint32_t bytesInRes, imageOffset;
+    };
+    IconDir header{ 0, 1, 1 };
+    IconDirEntry entry{};
+    entry.width = (uint8_t)img.cols;
+    entry.height = (uint8_t)img.rows;
+    entry.colorCount = 0;
+    entry.reserved = 0;
+    entry.planes = 1;
+    entry.bitCount = 32;
+    entry.bytesInRes = (uint32_t)pngBuf.size();
+    entry.imageOffset = sizeof(header) + sizeof(entry);
+
+    out.resize(sizeof(header) + sizeof(entry) + pngBuf.size());
+    std::memcpy(out.data(), &header, sizeof(header));
+    std::memcpy(out.data() + sizeof(header), &entry, sizeof(entry));
+    std::memcpy(out.data() + sizeof(header) + sizeof(entry), pngBuf.data(), pngBuf.size());
+    return true;
+}
+
+// -------------- 文件分派 -----------------
+
+std::optional<Format> formatFromExtension(std::string_view ext) {
+    std::string lower(ext);
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    if (lower == ".svg") return Format::Svg;
+    if (lower == ".ico") return Format::Ico;
+    if (lower == ".png") return Format::Png;
+    if (lower == ".jpg" || lower == ".jpeg") return Format::Jpeg;
+    if (lower == ".bmp") return Format::Bmp;
+    return std::nullopt;
+}
+
+const char* formatName(Format format) {
+    switch (format) {
+    case Format::Svg: return "svg";
+    case Format::Ico: return "ico";
+    case Format::Png: return "png";
+    case Format::Jpeg: return "jpeg";
+    case Format::Bmp: return "bmp";
+    }
+    return "?";
+}
+
+static std::optional<Format> formatOf(const fs::path& path) {
+    return formatFromExtension(path.extension().string());
+}
+
+// 把内存中一个文件的完整内容按格式变换为输出文件内容（不触碰磁盘）。
+// source 只用于出错信息；失败时已输出原因，返回 false。
+static bool transformBuffer(const uint8_t* data, size_t size, Format format, std::vector<uint8_t>& out, const fs::path& source) {
+    try {
+        switch (format) {
+        case Format::Svg: {
+            thread_local std::string text;
+            if (!transformSvg(std::string_view(reinterpret_cast<const char*>(data), size), text)) {
+                LogLine(std::cerr) << "无法读取: " << source << "\n";
+                return false;
+            }
+            out.assign(text.begin(), text.end());
+            return true;
+        }
+        case Format::Ico: {
+            IcoProcessor proc;
+            if (proc.loadIco(data, size)) {
+                proc.processHslInversion();
+                proc.buildIco(out);
+                return true;
+            }
+            // 兜底恢复
+            LogLine(std::cerr) << "[Recover] 尝试 OpenCV 强解 ICO..." << std::endl;
+            if (!recoverIcoViaImage(data, size, out)) {
+                LogLine(std::cerr) << "无法加载 ICO: " << source << "\n";
+                return false;
+            }
+            return true;
+        }
+        case Format::Png:
+        case Format::Jpeg:
+        case Format::Bmp: {
+            if (format == Format::Png && invertPalettePng(data, size, out)) return true;
+            cv::Mat img;
+            if (size > 0 && size <= static_cast<size_t>(INT_MAX)) {
+                StageTimer timer(Stage::Decode);
+                img = cv::imdecode(cv::Mat(1, static_cast<int>(size), CV_8UC1, const_cast<uint8_t*>(data)), cv::IMREAD_UNCHANGED);
+            }
+            if (img.empty()) {
+                LogLine(std::cerr) << "无法读取图像: " << source << "\n";
+                return false;
+            }
+            bool inverted;
+            {
+                StageTimer timer(Stage::Invert);
+                inverted = invertBrightness(img);
+            }
+            if (!inverted) {
+                LogLine(std::cerr) << "不支持的像素格式: " << source << "\n";
+                return false;
+            }
+            // 编码到内存，编码耗时与磁盘写入分开统计
+            const std::string ext = format == Format::Png ? ".png" : format == Format::Bmp ? ".bmp" : ".jpg";
+            EncodeTimer timer(format == Format::Png ? EncodeFormat::Png : format == Format::Bmp ? EncodeFormat::Bmp : EncodeFormat::Jpeg);
+            if (!cv::imencode(ext, img, out, imageWriteParams(ext))) {
+                LogLine(std::cerr) << "编码失败: " << source << "\n";
+                return false;
+            }
+            timer.record(out.size());
+            return true;
+        }
+        }
+    }
+    catch (const std::exception& e) {
+        LogLine(std::cerr) << "处理失败: " << source << "\n原因: " << e.what() << "\n";
+    }
+    return false;
+}
+
+bool invert(Span<const uint8_t> in, Format format, OutputBuffer& out) {
+    return transformBuffer(in.data(), in.size(), format, out, "<memory>");
+}
+
+// 把已读入内存的输入按扩展名变换为输出文件内容
+static bool transformFile(const fs::path& input, const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    std::optional<Format> format = formatOf(input);
+    if (!format) {
+        LogLine(std::cerr) << "不支持的文件格式: " << input << "\n";
+        return false;
+    }
+    return transformBuffer(data, size, *format, out, input);
+}
+
+// 64 位 FNV-1a 内容哈希
+static uint64_t fnv1a64(const uint8_t* p, size_t n) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001B3ull;
+    }
+    return h;
+}
+
+// processFile 的实现；inHash 非空时顺带对已读入的输入算内容哈希，供增量清单记录，不必再读一遍文件
+static bool processFileHashed(const fs::path& input, const fs::path& output, uint64_t* inHash) {
+    std::optional<Format> format = formatOf(input);
+    if (!format) {
+        LogLine(std::cerr) << "不支持的文件格式: " << input << "\n";
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    // 映射本身很快，缺页读盘会延后到解码阶段；这里记的是打开与建立映射的开销
+    StageTimer readTimer(Stage::Read);
+    MappedFile in(input);
+    readTimer.stop();
+    if (!in.isOpen()) {
+        LogLine(std::cerr) << "无法读取: " << input << "\n";
+        recordFileStat(*format, 0, 0, nanosSince(start), false);
+        return false;
+    }
+    if (inHash) *inHash = fnv1a64(in.data(), in.size());
+    // 输出缓冲按线程复用
+    thread_local std::vector<uint8_t> out;
+    if (!transformBuffer(in.data(), in.size(), *format, out, input)) {
+        recordFileStat(*format, in.size(), 0, nanosSince(start), false);
+        return false;
+    }
+    StageTimer writeTimer(Stage::Write);
+    bool ok = writeFileBytes(output, out.data(), out.size());
+    writeTimer.stop();
+    if (!ok) {
+        LogLine(std::cerr) << "写入失败: " << output << "\n";
+    }
+    recordFileStat(*format, in.size(), ok ? out.size() : 0, nanosSince(start), ok);
+    return ok;
+}
+
+bool processFile(const fs::path& input, const fs::path& output) {
+    return processFileHashed(input, output, nullptr);
+}
+
+// -------------- 增量处理清单 -----------------
+
+// 会改变输出内容的实现改动时递增，旧清单随之整体失效
+static constexpr const char* kToolVersion = "2";
+
+// 影响输出字节的设置指纹；--simd 与 integer 以外的 --inversion 结果逐位一致，不计入
+static std::string outputSettingsFingerprint() {
+    std::ostringstream os;
+    os << "v" << kToolVersion
+        << " svg=" << (g_svgMode == SvgMode::Dom ? "dom" : "stream")
+        << " ico-png=" << (g_icoPngCodec == IcoPngCodec::Builtin ? "builtin" : "opencv")
+        << " level=" << g_icoPngLevel
+        << " profile=" << static_cast<int>(g_encodeProfile)
+        << " pixels=" << (g_inversionMode == InversionMode::Integer ? "integer" : "float")
+        << " transparent=" << static_cast<int>(g_transparentPixels);
+    return os.str();
+}
+
+static bool hashFile(const fs::path& path, uint64_t& hash) {
+    MappedFile file(path);
+    if (!file.isOpen()) return false;
+    hash = fnv1a64(file.data(), file.size());
+    return true;
+}
+
+static int64_t mtimeTicks(const fs::path& path, std::error_code& ec) {
+    return static_cast<int64_t>(fs::last_write_time(path, ec).time_since_epoch().count());
+}
+
+// 输出目录下的增量清单：输入相对路径 -> 输入大小 / 修改时间 / 内容哈希，输出大小 / 修改时间。
+// 每行一条：各数值字段以制表符分隔，相对路径（UTF-8）放在行尾。
+// 判定规则：
+// - 设置指纹不同：全部重新处理
+// - 输入大小与修改时间都未变，且输出仍在、大小与修改时间未变：跳过
+// - 仅修改时间变了：重算内容哈希，与记录一致则视为未变（只刷新时间戳）
+// 本轮未出现的输入视为已删除，其输出一并删除。
+class IncrementalManifest {
+public:
+    static constexpr const char* kFileName = ".iconinverter-manifest";
+    // 格式变化时递增；旧格式的清单整体作废
+    static constexpr const char* kHeader = "IconInverter-manifest 2";
+
+    IncrementalManifest(const fs::path& outputDir, std::string settings)
+        : outputDir_(outputDir), settings_(std::move(settings)) {}
+
+    void load() {
+        std::ifstream in(outputDir_ / kFileName, std::ios::binary);
+        std::string line;
+        if (!in || !std::getline(in, line) || line != kHeader) return;
+        if (!std::getline(in, line) || line.rfind("settings ", 0) != 0) return;
+        settingsMatch_ = line.substr(9) == settings_;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            Entry e;
+            std::string inHash;
+            if (!(fields >> e.inSize >> e.inMtime >> inHash >> e.outSize >> e.outMtime)) continue;
+            fields.get(); // 路径前的制表符
+            std::string rel;
+            std::getline(fields, rel);
+            if (rel.empty()) continue;
+            e.inHash = std::strtoull(inHash.c_str(), nullptr, 16);
+            entries_[rel] = e;
+        }
+    }
+
+    // 由遍历线程调用；返回 true 表示可以跳过。无论结果如何都把该路径记为“本轮存在”
+    bool upToDate(const fs::path& relative, const fs::path& input, const fs::path& output) {
+        std::string key = relative.generic_u8string();
+        Entry e;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            seen_.insert(key);
+            auto it = entries_.find(key);
+            if (!settingsMatch_ || it == entries_.end()) return false;
+            e = it->second;
+        }
+        // 取文件状态与重算哈希都在锁外进行，工作线程的 record / forget 不必等待读盘
+        std::error_code ec;
+        uint64_t inSize = fs::file_size(input, ec);
+        int64_t inMtime = ec ? 0 : mtimeTicks(input, ec);
+        if (ec || e.inSize != inSize) return false;
+        uint64_t outSize = fs::file_size(output, ec);
+        int64_t outMtime = ec ? 0 : mtimeTicks(output, ec);
+        if (ec || outSize != e.outSize || outMtime != e.outMtime) return false;
+        bool touched = e.inMtime != inMtime;
+        if (touched) {
+            uint64_t hash = 0;
+            if (!hashFile(input, hash) || hash != e.inHash) return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (touched) {
+            auto it = entries_.find(key);
+            if (it != entries_.end()) it->second.inMtime = inMtime;
+            dirty_ = true;
+        }
+        ++skipped_;
+        return true;
+    }
+
+    // 由工作线程在 processFile 成功之后调用；inHash 为处理时对已读入内容算出的哈希。
+    // 这里只取文件状态，不再重读输入或输出；取不到状态时按失败处理
+    void record(const fs::path& relative, const fs::path& input, const fs::path& output, uint64_t inHash) {
+        Entry e;
+        e.inHash = inHash;
+        std::error_code ec;
+        e.inSize = fs::file_size(input, ec);
+        if (!ec) e.inMtime = mtimeTicks(input, ec);
+        if (!ec) e.outSize = fs::file_size(output, ec);
+        if (!ec) e.outMtime = mtimeTicks(output, ec);
+        if (ec) {
+            forget(relative);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[relative.generic_u8string()] = e;
+        dirty_ = true;
+    }
+
+    // 处理失败（不支持的格式、读取 / 变换 / 写出失败）时调用：删掉旧记录，下次必定重试。
+    // 上次成功时留下的输出保持原样，不会被当作孤立文件删除
+    void forget(const fs::path& relative) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entries_.erase(relative.generic_u8string())) dirty_ = true;
+    }
+
+    // 删除本轮未出现的输入所对应的输出，返回删除的文件数
+    size_t removeOrphans() {
+        size_t removed = 0;
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (seen_.count(it->first)) { ++it; continue; }
+            fs::path rel = fs::u8path(it->first);
+            // 清单可能被手工改过：只接受不含 .. 的相对路径，绝不删到输出目录之外
+            bool safe = rel.is_relative() && std::none_of(rel.begin(), rel.end(), [](const fs::path& part) { return part == ".."; });
+            std::error_code ec;
+            if (safe && fs::remove(outputDir_ / rel, ec)) {
+                ++removed;
+                LogLine(std::cout) << "已删除孤立输出: " << (outputDir_ / rel) << "\n";
+            }
+            it = entries_.erase(it);
+            dirty_ = true;
+        }
+        return removed;
+    }
+
+    // 先写临时文件再改名，中途中断不会留下半截清单
+    bool save() {
+        if (!dirty_ && settingsMatch_) return true;
+        fs::path target = outputDir_ / kFileName, tmp = target;
+        tmp += ".tmp";
+        std::error_code ec;
+        fs::create_directories(outputDir_, ec);
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out << kHeader << "\nsettings " << settings_ << "\n";
+            for (const auto& [rel, e] : entries_) {
+                out << e.inSize << '\t' << e.inMtime << '\t' << std::hex << e.inHash << std::dec << '\t'
+                    << e.outSize << '\t' << e.outMtime << '\t' << rel << '\n';
+            }
+            if (!out) return false;
+        }
+        fs::rename(tmp, target, ec);
+        return !ec;
+    }
+
+    size_t skipped() const { return skipped_; }
+
+private:
+    struct Entry {
+        uint64_t inSize = 0;
+        int64_t inMtime = 0;
+        uint64_t inHash = 0;
+        uint64_t outSize = 0;
+        int64_t outMtime = 0;
+    };
+
+    fs::path outputDir_;
+    std::string settings_;
+    bool settingsMatch_ = false;
+    bool dirty_ = false;
+    size_t skipped_ = 0;
+    std::map<std::string, Entry> entries_;
+    std::set<std::string> seen_;
+    std::mutex mutex_;
+};
+
+// -------------- 重复内容去重 -----------------
+
+// 重复输入的落地方式：
+// - Auto     : 优先 reflink（写时复制，Linux FICLONE / macOS clonefile），不支持时复制
+// - Hardlink : 硬链接到首个副本的输出（各副本共享同一份数据），失败时复制
+// - Copy     : 直接复制
+// 把已生成的 src 落地为 dst；返回实际使用的方式，全部失败时返回 std::nullopt
+static std::optional<const char*> materializeOutput(const fs::path& src, const fs::path& dst, DedupLink link) {
+    std::error_code ec;
+    fs::create_directories(dst.parent_path(), ec);
+    fs::remove(dst, ec);
+    if (link == DedupLink::Hardlink) {
+        fs::create_hard_link(src, dst, ec);
+        if (!ec) return "hardlink";
+    }
+    else if (link == DedupLink::Auto) {
+#if defined(__linux__) && defined(FICLONE)
+        int in = ::open(src.c_str(), O_RDONLY);
+        if (in >= 0) {
+            int out = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool cloned = out >= 0 && ::ioctl(out, FICLONE, in) == 0;
+            if (out >= 0) ::close(out);
+            ::close(in);
+            if (cloned) return "reflink";
+            fs::remove(dst, ec);
+        }
+#elif defined(__APPLE__)
+        if (::clonefile(src.c_str(), dst.c_str(), 0) == 0) return "reflink";
+#endif
+    }
+    ec.clear();
+    fs::copy_file(src, dst, fs::copy_options::overwrite_existing, ec);
+    if (!ec) return "copy";
+    return std::nullopt;
+}
+
+// 内容寻址去重：按（扩展名，大小，内容哈希）分组，每组只处理首个副本，
+// 其余副本在首个副本完成后直接落地其输出。哈希相同时再逐字节比对，排除碰撞。
+// 哈希按需计算：扩展名与大小都相同的文件出现第二个时，才读入并哈希这一桶里的文件，
+// 大小各异的大多数输入在遍历线程上只取一次文件大小，读盘仍留给工作线程 / 读入线程。
+// claim() 由遍历线程调用，finish() 由处理首个副本的工作线程调用。
+class DedupIndex {
+public:
+    static constexpr size_t kNoGroup = SIZE_MAX;
+
+    DedupIndex(DedupLink link, IncrementalManifest* manifest) : link_(link), manifest_(manifest) {}
+
+    // 返回 true 表示调用方需要正常处理该输入；group 为其所在组（首个副本）或 kNoGroup。
+    // 返回 false 表示这是重复内容：已落地，或挂在组上等首个副本完成后落地。
+    bool claim(const fs::path& input, const fs::path& output, const fs::path& relative, size_t& group) {
+        group = kNoGroup;
+        std::error_code ec;
+        uint64_t size = fs::file_size(input, ec);
+        if (ec) return true;
+        std::string ext = input.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        Key key{ ext, size };
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::vector<size_t>& bucket = index_[key];
+        if (bucket.empty()) {
+            group = addGroup(input, output, bucket);
+            return true;
+        }
+        std::vector<size_t> candidates = bucket;
+        lock.unlock();
+
+        MappedFile file(input);
+        if (!file.isOpen()) return true;
+        uint64_t hash = fnv1a64(file.data(), file.size());
+        for (size_t c : candidates) {
+            uint64_t firstHash = 0;
+            if (!groupHash(c, firstHash) || firstHash != hash) continue;
+            lock.lock();
+            fs::path firstInput = groups_[c].input;
+            lock.unlock();
+            MappedFile first(firstInput);
+            if (!first.isOpen() || first.size() != file.size() ||
+                std::memcmp(first.data(), file.data(), file.size()) != 0) {
+                continue; // 哈希碰撞
+            }
+            lock.lock();
+            Group& g = groups_[c];
+            Duplicate dup{ input, output, relative, file.size(), hash };
+            if (!g.done) {
+                g.waiting.push_back(std::move(dup));
+                return false;
+            }
+            Group snapshot = g;
+            lock.unlock();
+            materialize(snapshot, dup);
+            return false;
+        }
+        // 同扩展名同大小但内容不同：自成一组
+        lock.lock();
+        group = addGroup(input, output, index_[key]);
+        groups_[group].hashed = true;
+        groups_[group].hash = hash;
+        return true;
+    }
+
+    // ok 为首个副本是否成功写出；失败时挂在组上的重复文件一并跳过，不落地旧输出
+    void finish(size_t group, double elapsedMs, bool ok) {
+        if (group == kNoGroup) return;
+        std::vector<Duplicate> waiting;
+        Group snapshot;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Group& g = groups_[group];
+            g.done = true;
+            g.ok = ok;
+            g.elapsedMs = elapsedMs;
+            waiting.swap(g.waiting);
+            snapshot = g;
+        }
+        for (const auto& dup : waiting) materialize(snapshot, dup);
+    }
+
+    void report() const {
+        if (duplicates_ == 0) return;
+        LogLine(std::cout) << "\n[去重] 重复文件 " << duplicates_ << " 个，免去读取处理 " << bytesSaved_ << " 字节，省去处理耗时约 "
+            << static_cast<uint64_t>(msSaved_) << " ms（落地耗时 " << static_cast<uint64_t>(msSpent_) << " ms；reflink "
+            << reflinks_ << " 个，硬链接 " << hardlinks_ << " 个，复制 " << copies_ << " 个）\n";
+    }
+
+private:
+    struct Key {
+        std::string ext;
+        uint64_t size;
+        bool operator<(const Key& o) const { return std::tie(size, ext) < std::tie(o.size, o.ext); }
+    };
+    struct Duplicate {
+        fs::path input, output, relative;
+        uint64_t size, hash;
+    };
+    struct Group {
+        fs::path input, output;
+        bool hashed = false;   // hash 只在同桶出现第二个文件时才算
+        uint64_t hash = 0;
+        bool done = false;
+        bool ok = false;
+        double elapsedMs = 0;
+        std::vector<Duplicate> waiting;
+    };
+
+    // 调用方持有 mutex_
+    size_t addGroup(const fs::path& input, const fs::path& output, std::vector<size_t>& bucket) {
+        Group g;
+        g.input = input;
+        g.output = output;
+        groups_.push_back(std::move(g));
+        bucket.push_back(groups_.size() - 1);
+        return groups_.size() - 1;
+    }
+
+    // 取组内首个副本的内容哈希，尚未计算时在锁外读入计算。只有遍历线程会写这两个字段
+    bool groupHash(size_t group, uint64_t& hash) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Group& g = groups_[group];
+        if (g.hashed) {
+            hash = g.hash;
+            return true;
+        }
+        fs::path input = g.input;
+        lock.unlock();
+        if (!hashFile(input, hash)) return false;
+        lock.lock();
+        g.hashed = true;
+        g.hash = hash;
+        return true;
+    }
+
+    void materialize(const Group& g, const Duplicate& dup) {
+        auto start = std::chrono::steady_clock::now();
+        std::optional<const char*> method;
+        if (g.ok) method = materializeOutput(g.output, dup.output, link_);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!method) {
+            LogLine(std::cerr) << "[Warning] 首个副本 " << g.input << " 没有可用输出，跳过重复文件: " << dup.input << "\n";
+            if (manifest_) manifest_->forget(dup.relative);
+            return;
+        }
+        if (manifest_) manifest_->record(dup.relative, dup.input, dup.output, dup.hash);
+        LogLine(std::cout) << "已复用: " << dup.input << " <- " << g.input << "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++duplicates_;
+        bytesSaved_ += dup.size;
+        msSaved_ += g.elapsedMs;
+        msSpent_ += ms;
+        std::string_view m = *method;
+        if (m == "reflink") ++reflinks_;
+        else if (m == "hardlink") ++hardlinks_;
+        else ++copies_;
+    }
+
+    DedupLink link_;
+    IncrementalManifest* manifest_;
+    std::mutex mutex_;
+    std::map<Key, std::vector<size_t>> index_;
+    std::deque<Group> groups_; // deque：追加时不使已有元素的引用失效
+    size_t duplicates_ = 0, reflinks_ = 0, hardlinks_ = 0, copies_ = 0;
+    uint64_t bytesSaved_ = 0;
+    double msSaved_ = 0, msSpent_ = 0;
+};
+
+// -------------- 并行批处理 -----------------
+
+// 有界阻塞队列：生产者在队列满时等待，避免遍历大目录时任务无限堆积
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&] { return items_.size() < capacity_; });
+        items_.push_back(std::move(item));
+        notEmpty_.notify_one();
+    }
+
+    // 队列关闭且取空后返回 std::nullopt
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&] { return !items_.empty() || closed_; });
+        if (items_.empty()) return std::nullopt;
+        T item = std::move(items_.front());
+        items_.pop_front();
+        notFull_.notify_one();
+        return item;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        notEmpty_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    std::deque<T> items_;
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_, notFull_;
+};
+
+struct BatchTask {
+    size_t seq;
+    fs::path input, output, relative;
+    size_t dedupGroup;
+};
+
+// 递归遍历输入目录，按遍历顺序编号，逐个交给 emit（串行、--jobs、流水线三种模式共用）。
+// 增量模式下跳过未变化的文件；去重模式下重复内容在这里被认领，不再产生任务
+static void collectTasks(const std::string& inputDir, const std::string& outputDir, IncrementalManifest* manifest,
+    DedupIndex* dedup, const std::function<void(BatchTask&&)>& emit) {
+    size_t seq = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(inputDir)) {
+        if (!entry.is_regular_file()) continue;
+        fs::path relative = fs::relative(entry.path(), inputDir);
+        fs::path outPath = fs::path(outputDir) / relative;
+        if (manifest && manifest->upToDate(relative, entry.path(), outPath)) continue;
+        size_t group = DedupIndex::kNoGroup;
+        if (dedup && !dedup->claim(entry.path(), outPath, relative, group)) continue;
+        emit(BatchTask{ seq++, entry.path(), outPath, relative, group });
+    }
+}
+
+// 处理单个输入并计时（毫秒，供去重统计“省下的处理时间”）；返回是否成功写出。
+// inHash 非空时写入输入内容的哈希（增量清单用）
+static bool timedProcessFile(const fs::path& input, const fs::path& output, double& elapsedMs, uint64_t* inHash) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = processFileHashed(input, output, inHash);
+    elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+// 按处理结果更新清单：只有成功写出的才记为最新
+static void updateManifest(IncrementalManifest* manifest, bool ok, const fs::path& relative, const fs::path& input,
+    const fs::path& output, uint64_t inHash) {
+    if (!manifest) return;
+    if (ok) manifest->record(relative, input, output, inHash);
+    else manifest->forget(relative);
+}
+
+// 串行与 --jobs 模式的单个任务：处理、更新清单，并通知去重索引首个副本的结果
+static void processTask(const BatchTask& task, IncrementalManifest* manifest, DedupIndex* dedup) {
+    double ms = 0;
+    uint64_t inHash = 0;
+    bool ok = timedProcessFile(task.input, task.output, ms, manifest ? &inHash : nullptr);
+    updateManifest(manifest, ok, task.relative, task.input, task.output, inHash);
+    if (dedup) dedup->finish(task.dedupGroup, ms, ok);
+}
+
+// 按序号重排进度输出：完成顺序任意，打印顺序与遍历顺序一致
+class OrderedProgress {
+public:
+    void done(size_t seq, const fs::path& path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.emplace(seq, path);
+        for (auto it = pending_.begin(); it != pending_.end() && it->first == next_; it = pending_.erase(it), ++next_) {
+            LogLine(std::cout) << "已处理: " << it->second << "\n";
+        }
+    }
+private:
+    std::mutex mutex_;
+    std::map<size_t, fs::path> pending_;
+    size_t next_ = 0;
+};
+
+static void runParallelBatch(const std::string& inputDir, const std::string& outputDir, const BatchOptions& opts, int jobs,
+    IncrementalManifest* manifest, DedupIndex* dedup) {
+    // 单个生产者（当前线程）遍历目录，jobs 个工作线程执行 processFile
+    BoundedQueue<BatchTask> queue(static_cast<size_t>(jobs) * 4);
+    OrderedProgress ordered;
+    std::vector<std::thread> workers;
+    for (int w = 0; w < jobs; ++w) {
+        workers.emplace_back([&] {
+            while (auto task = queue.pop()) {
+                processTask(*task, manifest, dedup);
+                if (opts.orderedProgress) ordered.done(task->seq, task->input);
+                else LogLine(std::cout) << "已处理: " << task->input << "\n";
+            }
+            });
+    }
+    try {
+        collectTasks(inputDir, outputDir, manifest, dedup, [&](BatchTask&& task) { queue.push(std::move(task)); });
+    }
+    catch (...) {
+        queue.close();
+        for (auto& t : workers) t.join();
+        throw;
+    }
+    queue.close();
+    for (auto& t : workers) t.join();
+}
+
+// 三段流水线：遍历线程 -> 读入线程 -> 计算线程 -> 写出线程。
+// 段与段之间是有界队列：下游跟不上时上游阻塞（背压），同时驻留内存的文件数有上限；
+// 磁盘 / 网络盘的读写等待落在 I/O 线程上，计算线程只做变换，两者相互重叠。
+struct PipelineItem {
+    BatchTask task;
+    std::unique_ptr<MappedFile> input; // 读入段不映射，整块读进自有缓冲
+    std::vector<uint8_t> output;
+    bool readOk = false, ok = false;
+    double elapsedMs = 0;
+    size_t inputBytes = 0;     // 输入在计算后即释放，统计用的大小单独保留
+    uint64_t readNanos = 0;    // 读入段耗时，与计算、写出段合计为该文件的处理耗时
+    uint64_t inHash = 0;       // 输入内容哈希，仅增量模式在计算段算出
+};
+
+static void runPipelineBatch(const std::string& inputDir, const std::string& outputDir, const BatchOptions& opts, int jobs,
+    IncrementalManifest* manifest, DedupIndex* dedup) {
+    int ioThreads = std::max(1, opts.ioThreads);
+    BoundedQueue<BatchTask> readQueue(static_cast<size_t>(ioThreads) * 4);
+    BoundedQueue<PipelineItem> computeQueue(static_cast<size_t>(jobs) * 2);
+    BoundedQueue<PipelineItem> writeQueue(static_cast<size_t>(ioThreads) * 2);
+    OrderedProgress ordered;
+
+    std::vector<std::thread> readers, computers, writers;
+    for (int r = 0; r < ioThreads; ++r) {
+        readers.emplace_back([&] {
+            while (auto task = readQueue.pop()) {
+                PipelineItem item;
+                item.task = std::move(*task);
+                // 不支持的格式不读内容，交给计算段统一报错
+                if (formatOf(item.task.input)) {
+                    auto start = std::chrono::steady_clock::now();
+                    item.input = std::make_unique<MappedFile>(item.task.input, false);
+                    item.readOk = item.input->isOpen();
+                    item.readNanos = nanosSince(start);
+                    item.inputBytes = item.input->size();
+                    addStageNanos(Stage::Read, item.readNanos);
+                }
+                computeQueue.push(std::move(item));
+            }
+            });
+    }
+    for (int c = 0; c < jobs; ++c) {
+        computers.emplace_back([&] {
+            while (auto item = computeQueue.pop()) {
+                auto start = std::chrono::steady_clock::now();
+                if (item->readOk) {
+                    if (manifest) item->inHash = fnv1a64(item->input->data(), item->input->size());
+                    item->ok = transformFile(item->task.input, item->input->data(), item->input->size(), item->output);
+                }
+                else if (formatOf(item->task.input)) {
+                    LogLine(std::cerr) << "无法读取: " << item->task.input << "\n";
+                }
+                else {
+                    LogLine(std::cerr) << "不支持的文件格式: " << item->task.input << "\n";
+                }
+                item->elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                item->input.reset(); // 输入已用完，尽早归还内存
+                writeQueue.push(std::move(*item));
+            }
+            });
+    }
+    for (int w = 0; w < ioThreads; ++w) {
+        writers.emplace_back([&] {
+            while (auto item = writeQueue.pop()) {
+                const BatchTask& task = item->task;
+                auto start = std::chrono::steady_clock::now();
+                bool written = false;
+                if (item->ok) {
+                    StageTimer timer(Stage::Write);
+                    written = writeFileBytes(task.output, item->output.data(), item->output.size());
+                    if (!written) LogLine(std::cerr) << "写入失败: " << task.output << "\n";
+                }
+                uint64_t nanos = item->readNanos + static_cast<uint64_t>(item->elapsedMs * 1e6) + nanosSince(start);
+                if (std::optional<Format> format = formatOf(task.input)) {
+                    recordFileStat(*format, item->inputBytes, written ? item->output.size() : 0, nanos, written);
+                }
+                updateManifest(manifest, written, task.relative, task.input, task.output, item->inHash);
+                if (dedup) dedup->finish(task.dedupGroup, item->elapsedMs, written);
+                if (opts.orderedProgress) ordered.done(task.seq, task.input);
+                else LogLine(std::cout) << "已处理: " << task.input << "\n";
+            }
+            });
+    }
+
+    // 逐段关闭：上游线程全部退出后才关闭下游队列，保证已入队的条目都被处理完
+    auto drain = [&] {
+        readQueue.close();
+        for (auto& t : readers) t.join();
+        computeQueue.close();
+        for (auto& t : computers) t.join();
+        writeQueue.close();
+        for (auto& t : writers) t.join();
+        };
+    try {
+        collectTasks(inputDir, outputDir, manifest, dedup, [&](BatchTask&& task) { readQueue.push(std::move(task)); });
+    }
+    catch (...) {
+        drain();
+        throw;
+    }
+    drain();
+}
+
+void batchProcess(const std::string& inputDir, const std::string& outputDir, const BatchOptions& opts) {
+    auto batchStart = std::chrono::steady_clock::now();
+    int jobs = opts.jobs > 0 ? opts.jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::optional<IncrementalManifest> manifest;
+    if (opts.incremental) {
+        manifest.emplace(fs::path(outputDir), outputSettingsFingerprint());
+        manifest->load();
+    }
+    IncrementalManifest* m = manifest ? &*manifest : nullptr;
+    std::optional<DedupIndex> dedup;
+    if (opts.dedup) dedup.emplace(*opts.dedup, m);
+    DedupIndex* d = dedup ? &*dedup : nullptr;
+    if (opts.ioThreads > 0) {
+        runPipelineBatch(inputDir, outputDir, opts, jobs, m, d);
+    }
+    else if (jobs == 1) {
+        collectTasks(inputDir, outputDir, m, d, [&](BatchTask&& task) {
+            processTask(task, m, d);
+            LogLine(std::cout) << "已处理: " << task.input << "\n";
+            });
+    }
+    else {
+        runParallelBatch(inputDir, outputDir, opts, jobs, m, d);
+    }
+    if (d) d->report();
+
+    if (m) {
+        size_t removed = m->removeOrphans();
+        if (!m->save()) LogLine(std::cerr) << "[Warning] 增量清单写入失败: " << (fs::path(outputDir) / IncrementalManifest::kFileName) << "\n";
+        LogLine(std::cout) << "\n[增量] 跳过未变化 " << m->skipped() << " 个，删除孤立输出 " << removed << " 个\n";
+    }
+
+    uint64_t hits = g_colorCacheHits.exchange(0), misses = g_colorCacheMisses.exchange(0);
+    if (hits + misses > 0) {
+        LogLine(std::cout) << "\n[SVG 颜色缓存] 命中 " << hits << " 次，未命中 " << misses << " 次，命中率 "
+            << (hits * 1000 / (hits + misses)) / 10.0 << "%\n";
+    }
+    reportEncodeStats();
+    reportBatchStats(nanosSince(batchStart) / 1e9, opts.statsJson);
+}
+
+} // namespace iconinv
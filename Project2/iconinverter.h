@@ -0,0 +1,189 @@
+﻿/*
+========================================
+【IconInverter 核心库】
+========================================
+
+把图标的亮度反转（HSL 模型下 L 分量取反）封装为可在进程内调用的库：
+- invert()       : 内存到内存，按格式变换一个文件的完整内容，全程不访问文件系统
+- processFile()  : 单个文件到文件
+- batchProcess() : 递归处理整个目录（命令行工具即是它的一层薄包装）
+
+各 set*() 是进程级设置，应在开始处理前调用，处理过程中不要修改。
+invert() / processFile() 可在多个线程中同时调用。
+本头文件不依赖 OpenCV 与 TinyXML2 的头文件。
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace iconinv {
+
+// ------------------- 内存接口 --------------------------
+
+// C++17 没有 std::span，这里提供一个连续区间视图的最小替代：只持有指针与长度，不拥有数据
+template <typename T>
+class Span {
+public:
+    constexpr Span() noexcept = default;
+    constexpr Span(T* data, size_t size) noexcept : data_(data), size_(size) {}
+    // 从 std::vector / std::array 等提供 data() / size() 的连续容器构造
+    template <typename C, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<C&>().data()), T*>>>
+    constexpr Span(C& c) noexcept : data_(c.data()), size_(c.size()) {}
+
+    constexpr T* data() const noexcept { return data_; }
+    constexpr size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+    constexpr T* begin() const noexcept { return data_; }
+    constexpr T* end() const noexcept { return data_ + size_; }
+    constexpr T& operator[](size_t i) const noexcept { return data_[i]; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// 把文本（如已读入内存的 SVG）视作字节区间
+inline Span<const uint8_t> asBytes(std::string_view text) noexcept {
+    return { reinterpret_cast<const uint8_t*>(text.data()), text.size() };
+}
+
+enum class Format { Svg, Ico, Png, Jpeg, Bmp };
+constexpr size_t kFormatCount = 5;
+
+// 按扩展名识别格式（带点，大小写不敏感，如 ".PNG"）；不支持的扩展名返回 std::nullopt
+std::optional<Format> formatFromExtension(std::string_view ext);
+// 格式的小写短名："svg" / "ico" / "png" / "jpeg" / "bmp"
+const char* formatName(Format format);
+
+// 输出缓冲：同一个对象跨多次调用复用时，容量稳定后不再分配
+using OutputBuffer = std::vector<uint8_t>;
+
+// 把 in（一个完整文件的内容）按 format 做亮度反转，结果写入 out（覆盖原有内容）。
+// 输出格式与输入相同。失败返回 false，原因输出到 stderr。
+bool invert(Span<const uint8_t> in, Format format, OutputBuffer& out);
+
+// ------------------- 处理设置 --------------------------
+
+// 亮度反转的实现，前四种输出逐位一致：
+// - Exact   : 逐像素浮点 HSL 计算，作为校验基准
+// - Simd    : 向量化的浮点计算（默认）
+// - Lut     : 全量查找表，约 48MB，首次使用时构建
+// - Compact : 紧凑查找表，约 8MB
+// - Integer : 整数闭式公式 out = c + 255 - max - min，不经浮点、不建表，速度最快；
+//             它是实数意义下的精确解，浮点基准截断取整，多数值比它小 1，因此与其他模式最多相差 1
+enum class InversionMode { Exact, Simd, Lut, Compact, Integer };
+void setInversionMode(InversionMode mode);
+InversionMode inversionMode();
+const char* inversionModeName(InversionMode mode);
+
+// 某个反转实现与浮点基准（rgbToHsl / hslToRgb）的比较结果
+struct InversionCheck {
+    InversionMode mode = InversionMode::Exact;
+    const char* layout = "BGR";  // 像素布局：BGR、BGRA、RGB、RGBA
+    uint64_t checked = 0;        // 比较的 RGB 值个数
+    uint64_t mismatched = 0;     // 至少一个通道与基准不同的个数
+    int maxDeviation = 0;        // 单通道最大绝对偏差
+    uint64_t alphaChanged = 0;   // 四通道布局中 alpha 被改动的个数，必须为 0
+    uint64_t nanos = 0;          // 该实现处理全部值的累计耗时（不含建表）
+};
+
+// 遍历全部 2^24 个 RGB 值，按 BGR / BGRA / RGB / RGBA 四种布局逐一比较 modes 中各实现与浮点基准的结果
+// （使用当前 SIMD 指令集），每个实现、每种布局各一条结果。耗时较长（十秒左右），用于校验与对比，不应在处理过程中调用
+std::vector<InversionCheck> verifyInversion(const std::vector<InversionMode>& modes);
+
+// 带 alpha 的图像中完全透明（alpha = 0）像素的处理；图像的 alpha 全为 0 时视为没有使用 alpha，一律照常反转：
+// - Invert : 与其他像素一样反转（默认）
+// - Skip   : 原样保留，只反转可见像素；透明区域大的图标处理更快，可见效果与 Invert 相同
+// - Clear  : 不反转并把颜色清零，透明区域变得整齐，PNG 压缩后更小
+enum class TransparentPixels { Invert, Skip, Clear };
+void setTransparentPixels(TransparentPixels mode);
+TransparentPixels transparentPixels();
+
+// rgb() 解析器的回归校验：用固定种子生成 cases 个按语法拼出并随机变异的字符串，
+// 与保留下来的旧版正则解析器逐一比较；再核对一组 CSS Color 4 新写法的固定样例
+struct ColorParserCheck {
+    uint64_t checked = 0;         // 随机样例数
+    uint64_t legacyAccepted = 0;  // 旧解析器接受的个数，新解析器须给出相同的 RGB
+    uint64_t extended = 0;        // 只有新解析器接受的个数（新语法）
+    uint64_t mismatched = 0;      // 旧解析器接受、新解析器却拒绝或结果不同的个数
+    uint64_t goldenFailed = 0;    // 固定样例中结果不符的个数
+    std::string firstFailure;     // 第一个出错的输入，便于复现
+};
+ColorParserCheck verifyColorParser(uint32_t seed, size_t cases);
+
+// Simd 模式使用的指令集，默认按 CPU 特性自动选择
+enum class SimdLevel { Portable, Sse41, Avx2 };
+// CPU 不支持时返回 false 并保持原设置
+bool setSimdLevel(SimdLevel level);
+SimdLevel simdLevel();
+const char* simdLevelName(SimdLevel level);
+
+// SVG 处理方式：
+// - Dom    : tinyxml2 载入整棵 DOM 后改写属性再序列化（会重新排版输出，默认）
+// - Stream : 单遍扫描原始字节，只替换颜色值，其余内容逐字节原样保留
+enum class SvgMode { Dom, Stream };
+void setSvgMode(SvgMode mode);
+SvgMode svgMode();
+
+// ICO 内嵌 PNG 的编解码方式：
+// - Builtin : 自带的 minipng 直接处理 8 位 RGBA PNG（默认），其他 PNG 自动退回 OpenCV
+// - OpenCV  : 一律走 cv::imdecode / cv::imencode
+enum class IcoPngCodec { Builtin, OpenCV };
+void setIcoPngCodec(IcoPngCodec codec);
+IcoPngCodec icoPngCodec();
+// Builtin 方式的 PNG 压缩级别 0..9；setEncodeProfile() 会把它重设为档位对应的级别
+void setIcoPngLevel(int level);
+
+// 内置 PNG 编码器的往返校验：用固定种子生成一组合成 RGBA 图像（噪声、纯色、渐变、稀疏、
+// 长重复、少色块等，含 1x1 与奇数尺寸），在各压缩级别下编码再解码，要求与原像素逐字节一致
+struct PngRoundTripCheck {
+    int level = 0;
+    uint64_t images = 0;        // 校验的图像数
+    uint64_t failed = 0;        // 编码失败、解码失败或像素不一致的个数
+    uint64_t rawBytes = 0;      // 原始像素字节数
+    uint64_t encodedBytes = 0;  // 编码后的 PNG 字节数
+    uint64_t nanos = 0;         // 编码累计耗时
+    std::string firstFailure;   // 第一个出错的图像描述
+};
+std::vector<PngRoundTripCheck> verifyPngRoundTrip(uint32_t seed);
+
+// 输出编码在速度与体积之间的取舍（PNG 为无损，只影响耗时与体积；JPEG 质量固定为 95，只有 Small 改变编码方式）：
+// - Fast     : PNG 压缩级别 1 + RLE 策略，JPEG 质量 95（与 OpenCV 默认参数相同，默认）
+// - Balanced : PNG 级别 6 + 默认策略，JPEG 质量 95
+// - Small    : PNG 级别 9 + FILTERED 策略，JPEG 质量 95 并开启哈夫曼表优化与渐进式编码
+enum class EncodeProfile { Fast, Balanced, Small };
+void setEncodeProfile(EncodeProfile profile);
+
+// ------------------- 文件与批处理 --------------------------
+
+// 读入 input、变换后写出到 output（父目录不存在时创建）；成功写出返回 true，失败原因输出到 stderr
+bool processFile(const std::filesystem::path& input, const std::filesystem::path& output);
+
+// 重复输入的落地方式：
+// - Auto     : 优先 reflink（写时复制，Linux FICLONE / macOS clonefile），不支持时复制
+// - Hardlink : 硬链接到首个副本的输出（各副本共享同一份数据），失败时复制
+// - Copy     : 直接复制
+enum class DedupLink { Auto, Hardlink, Copy };
+
+struct BatchOptions {
+    int jobs = 1;                  // 工作线程数；<= 0 表示使用全部硬件线程
+    bool orderedProgress = false;  // 并行时按遍历顺序输出“已处理”行
+    bool incremental = false;      // 借助输出目录下的清单跳过未变化的输入
+    std::optional<DedupLink> dedup; // 设置时对内容相同的输入只处理一次
+    int ioThreads = 0;             // > 0 时改用读入 / 计算 / 写出三段流水线，读写各用这么多线程
+    std::string statsJson;         // 非空时把阶段与格式统计另存为该 JSON 文件
+};
+
+// 递归处理 inputDir 下的全部文件，按相对路径写入 outputDir；进度与统计输出到控制台
+void batchProcess(const std::string& inputDir, const std::string& outputDir, const BatchOptions& opts = {});
+
+} // namespace iconinv
@@ -0,0 +1,93 @@
+﻿/*
+========================================
+【IconInverter 内部内核接口】
+========================================
+
+供基准测试等直接测量单个环节使用，不属于稳定的库接口；
+正常使用只需 iconinverter.h。
+Windows 下须在包含本文件前定义 NOGDI（或不包含 windows.h），否则 wingdi.h 的 RGB 宏会与 struct RGB 冲突。
+*/
+
+#pragma once
+
+#include "iconinverter.h"
+
+#include <cstring>
+#include <opencv2/opencv.hpp>
+
+namespace iconinv {
+
+// RGB 与 HSL 的颜色模型定义
+struct RGB { uint8_t r, g, b, a; };
+struct HSL { float h, s, l; };
+
+// 单像素浮点 HSL 转换（Exact 模式的基准实现）
+HSL rgbToHsl(RGB rgb);
+RGB hslToRgb(HSL hsl);
+
+// 按当前 InversionMode 就地反转图像的亮度：支持 8U / 16U / 32F 深度的 1 / 3 / 4 通道（BGR / BGRA）图像，
+// alpha 不变；其他类型返回 false，图像不变
+bool invertBrightness(cv::Mat& image);
+
+// 反转亮度：输入 CSS 颜色字符串 -> 写出新的十六进制颜色（统一为 #RRGGBB）；不是颜色时返回 false
+bool invertColorString(std::string_view in, char (&outHex)[8]);
+
+// SVG 颜色反转缓存。
+// 图标包的调色板很小，同一个 "#333333" 会在成千上万个文件里反复出现。
+// 每个工作线程持有一份直接映射缓存：按原始属性值（未 trim）哈希定位槽位，键内联存放，
+// 冲突时直接覆盖。容量固定（4096 槽 × 64 字节 = 256KB），超长的值不进缓存，
+// 因此恶意输入无法撑大内存，命中路径也没有任何分配。
+class ColorInversionCache {
+public:
+    static constexpr size_t kSlots = 4096;
+    static constexpr size_t kMaxKeyLen = 50;
+
+    // 与 invertColorString 语义一致：返回是否为可反转的颜色
+    bool invert(std::string_view raw, char (&outHex)[8]) {
+        if (raw.size() > kMaxKeyLen) {
+            ++misses_;
+            return invertColorString(raw, outHex);
+        }
+        uint32_t h = 2166136261u;
+        for (char c : raw) { h ^= static_cast<uint8_t>(c); h *= 16777619u; }
+        Slot& slot = slots_[(h ^ (h >> 16)) & (kSlots - 1)];
+        if (slot.state != kEmpty && slot.hash == h && slot.keyLen == raw.size() &&
+            std::memcmp(slot.key, raw.data(), raw.size()) == 0) {
+            ++hits_;
+            if (slot.state == kNotColor) return false;
+            std::memcpy(outHex, slot.hex, 7);
+            outHex[7] = '\0';
+            return true;
+        }
+        ++misses_;
+        bool isColor = invertColorString(raw, outHex);
+        slot.hash = h;
+        slot.keyLen = static_cast<uint8_t>(raw.size());
+        slot.state = isColor ? kColor : kNotColor;
+        if (isColor) std::memcpy(slot.hex, outHex, 7);
+        std::memcpy(slot.key, raw.data(), raw.size());
+        return isColor;
+    }
+
+    // 把本线程的计数累加到全局统计并清零
+    void flushStats();
+
+    static ColorInversionCache& local() {
+        thread_local ColorInversionCache cache;
+        return cache;
+    }
+
+private:
+    enum : uint8_t { kEmpty = 0, kColor = 1, kNotColor = 2 };
+    struct Slot {
+        uint32_t hash;
+        uint8_t keyLen;
+        uint8_t state;
+        char hex[7];
+        char key[kMaxKeyLen + 1];
+    };
+    std::vector<Slot> slots_ = std::vector<Slot>(kSlots, Slot{});
+    uint64_t hits_ = 0, misses_ = 0;
+};
+
+} // namespace iconinv
@@ -0,0 +1,899 @@
+#include "minipng.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace minipng {
+
+namespace {
+
+const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+constexpr uint32_t kMaxDimension = 1u << 14;
+
+// ------------------- 校验和 --------------------------
+
+const std::array<uint32_t, 256>& crcTable() {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+        }();
+    return table;
+}
+
+uint32_t crc32(const uint8_t* p, size_t n, uint32_t crc = 0) {
+    const auto& t = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = t[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+uint32_t adler32(const uint8_t* p, size_t n) {
+    uint32_t a = 1, b = 0;
+    while (n > 0) {
+        size_t block = std::min<size_t>(n, 5552); // 5552 字节内累加不会溢出
+        n -= block;
+        for (; block > 0; --block) { a += *p++; b += a; }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+uint32_t readBe32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+void appendBe32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(uint8_t(v >> 24));
+    out.push_back(uint8_t(v >> 16));
+    out.push_back(uint8_t(v >> 8));
+    out.push_back(uint8_t(v));
+}
+
+// ------------------- deflate 公共表 --------------------------
+
+const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t kDistBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t kDistExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const uint8_t kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+constexpr int kMaxBits = 15;
+
+uint32_t reverseBits(uint32_t code, int len) {
+    uint32_t r = 0;
+    for (int i = 0; i < len; ++i, code >>= 1) r = (r << 1) | (code & 1);
+    return r;
+}
+
+// ------------------- inflate --------------------------
+
+// LSB 优先的位读取器；读过末尾时补零并记为“虚位”，真正消耗到虚位即判定数据截断
+class BitReader {
+public:
+    BitReader(const uint8_t* p, const uint8_t* end) : p_(p), end_(end) {}
+
+    uint32_t peek(int n) {
+        while (cnt_ <= 24) {
+            uint32_t byte = 0;
+            if (p_ < end_) byte = *p_++;
+            else phantom_ += 8;
+            buf_ |= byte << cnt_;
+            cnt_ += 8;
+        }
+        return buf_ & ((1u << n) - 1);
+    }
+    void consume(int n) { buf_ >>= n; cnt_ -= n; }
+    uint32_t bits(int n) {
+        if (n == 0) return 0;
+        uint32_t v = peek(n);
+        consume(n);
+        return v;
+    }
+    bool overrun() const { return cnt_ < phantom_; }
+
+    // 丢弃到字节边界，返回下一个未消耗字节的位置，并清空位缓冲
+    const uint8_t* alignToByte() {
+        consume(cnt_ & 7);
+        const uint8_t* pos = p_ - (cnt_ - phantom_) / 8;
+        buf_ = 0;
+        cnt_ = phantom_ = 0;
+        p_ = pos;
+        return pos;
+    }
+    void seek(const uint8_t* pos) { p_ = pos; }
+    const uint8_t* end() const { return end_; }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint32_t buf_ = 0;
+    int cnt_ = 0;
+    int phantom_ = 0;
+};
+
+// 规范哈夫曼解码表：短码（<= kFastBits）一次查表，长码逐位走规范编码
+struct Huffman {
+    static constexpr int kFastBits = 10;
+    uint16_t fast[1 << kFastBits];  // (码长 << 9) | 符号；0 表示需走慢路径
+    int16_t count[kMaxBits + 1];
+    int16_t symbol[288];
+
+    // 返回 false 表示码长集合超额（不合法）；不完整的码表按 deflate 惯例接受
+    bool build(const uint8_t* lengths, int n) {
+        std::memset(count, 0, sizeof(count));
+        std::memset(fast, 0, sizeof(fast));
+        for (int s = 0; s < n; ++s) count[lengths[s]]++;
+        count[0] = 0;
+        int left = 1;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            left = (left << 1) - count[len];
+            if (left < 0) return false;
+        }
+        int offs[kMaxBits + 2] = {};
+        for (int len = 1; len <= kMaxBits; ++len) offs[len + 1] = offs[len] + count[len];
+        uint32_t nextCode[kMaxBits + 2] = {};
+        for (int len = 1, code = 0; len <= kMaxBits; ++len) {
+            code = (code + count[len - 1]) << 1;
+            nextCode[len] = code;
+        }
+        for (int s = 0; s < n; ++s) {
+            int len = lengths[s];
+            if (len == 0) continue;
+            symbol[offs[len]++] = static_cast<int16_t>(s);
+            uint32_t code = nextCode[len]++;
+            if (len <= kFastBits) {
+                for (uint32_t r = reverseBits(code, len); r < (1u << kFastBits); r += 1u << len) {
+                    fast[r] = static_cast<uint16_t>((len << 9) | s);
+                }
+            }
+        }
+        return true;
+    }
+
+    int decode(BitReader& br) const {
+        uint16_t e = fast[br.peek(kFastBits)];
+        if (e) {
+            br.consume(e >> 9);
+            return e & 511;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            code |= static_cast<int>(br.bits(1));
+            int c = count[len];
+            if (code - c < first) return symbol[index + (code - first)];
+            index += c;
+            first = (first + c) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+const Huffman& fixedLitLen() {
+    static const Huffman h = [] {
+        uint8_t lengths[288];
+        for (int i = 0; i < 144; ++i) lengths[i] = 8;
+        for (int i = 144; i < 256; ++i) lengths[i] = 9;
+        for (int i = 256; i < 280; ++i) lengths[i] = 7;
+        for (int i = 280; i < 288; ++i) lengths[i] = 8;
+        Huffman t;
+        t.build(lengths, 288);
+        return t;
+        }();
+    return h;
+}
+
+const Huffman& fixedDist() {
+    static const Huffman h = [] {
+        uint8_t lengths[30];
+        std::fill(std::begin(lengths), std::end(lengths), uint8_t(5));
+        Huffman t;
+        t.build(lengths, 30);
+        return t;
+        }();
+    return h;
+}
+
+bool inflateCodes(BitReader& br, const Huffman& lit, const Huffman& dist, uint8_t* out, size_t outLen, size_t& pos) {
+    for (;;) {
+        int sym = lit.decode(br);
+        if (sym < 0 || br.overrun()) return false;
+        if (sym < 256) {
+            if (pos >= outLen) return false;
+            out[pos++] = static_cast<uint8_t>(sym);
+        }
+        else if (sym == 256) {
+            return true;
+        }
+        else {
+            sym -= 257;
+            if (sym >= 29) return false;
+            size_t len = kLengthBase[sym] + br.bits(kLengthExtra[sym]);
+            int dsym = dist.decode(br);
+            if (dsym < 0 || dsym >= 30) return false;
+            size_t d = kDistBase[dsym] + br.bits(kDistExtra[dsym]);
+            if (br.overrun() || d > pos || len > outLen - pos) return false;
+            const uint8_t* src = out + pos - d;
+            uint8_t* dst = out + pos;
+            for (size_t i = 0; i < len; ++i) dst[i] = src[i]; // 可能重叠，逐字节拷贝
+            pos += len;
+        }
+    }
+}
+
+bool inflateDynamic(BitReader& br, uint8_t* out, size_t outLen, size_t& pos) {
+    int nlen = static_cast<int>(br.bits(5)) + 257;
+    int ndist = static_cast<int>(br.bits(5)) + 1;
+    int ncode = static_cast<int>(br.bits(4)) + 4;
+    if (nlen > 286 || ndist > 30) return false;
+
+    uint8_t lengths[320] = {};
+    for (int i = 0; i < ncode; ++i) lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(br.bits(3));
+    Huffman codeLen;
+    if (!codeLen.build(lengths, 19)) return false;
+
+    std::memset(lengths, 0, sizeof(lengths));
+    for (int i = 0; i < nlen + ndist;) {
+        int sym = codeLen.decode(br);
+        if (sym < 0 || br.overrun()) return false;
+        if (sym < 16) {
+            lengths[i++] = static_cast<uint8_t>(sym);
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (sym == 16) {
+            if (i == 0) return false;
+            value = lengths[i - 1];
+            repeat = 3 + static_cast<int>(br.bits(2));
+        }
+        else if (sym == 17) repeat = 3 + static_cast<int>(br.bits(3));
+        else repeat = 11 + static_cast<int>(br.bits(7));
+        if (i + repeat > nlen + ndist) return false;
+        while (repeat--) lengths[i++] = value;
+    }
+    if (lengths[256] == 0) return false; // 必须有块结束符
+
+    Huffman lit, dist;
+    if (!lit.build(lengths, nlen) || !dist.build(lengths + nlen, ndist)) return false;
+    return inflateCodes(br, lit, dist, out, outLen, pos);
+}
+
+// 解 zlib 流到定长缓冲；要求恰好产出 outLen 字节且 Adler-32 校验通过
+bool zlibInflate(const uint8_t* in, size_t inLen, uint8_t* out, size_t outLen) {
+    if (inLen < 6) return false;
+    if ((in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) return false;
+    BitReader br(in + 2, in + inLen);
+    size_t pos = 0;
+    bool last = false;
+    while (!last) {
+        last = br.bits(1) != 0;
+        uint32_t type = br.bits(2);
+        bool ok = false;
+        if (type == 0) {
+            const uint8_t* p = br.alignToByte();
+            if (br.end() - p < 4) return false;
+            uint32_t len = p[0] | (p[1] << 8), nlen = p[2] | (p[3] << 8);
+            p += 4;
+            if ((len ^ 0xFFFF) != nlen || size_t(br.end() - p) < len || len > outLen - pos) return false;
+            std::memcpy(out + pos, p, len);
+            pos += len;
+            br.seek(p + len);
+            ok = true;
+        }
+        else if (type == 1) ok = inflateCodes(br, fixedLitLen(), fixedDist(), out, outLen, pos);
+        else if (type == 2) ok = inflateDynamic(br, out, outLen, pos);
+        if (!ok || br.overrun()) return false;
+    }
+    const uint8_t* tail = br.alignToByte();
+    if (pos != outLen || br.end() - tail < 4) return false;
+    return readBe32(tail) == adler32(out, outLen);
+}
+
+// ------------------- deflate --------------------------
+
+// LSB 优先的位写入器
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+    void put(uint32_t value, int n) {
+        buf_ |= uint64_t(value) << cnt_;
+        cnt_ += n;
+        while (cnt_ >= 8) {
+            out_.push_back(static_cast<uint8_t>(buf_));
+            buf_ >>= 8;
+            cnt_ -= 8;
+        }
+    }
+    void flushToByte() {
+        if (cnt_ > 0) put(0, 8 - cnt_);
+    }
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t buf_ = 0;
+    int cnt_ = 0;
+};
+
+// 由频次构造码长不超过 maxBits 的哈夫曼码长；超长时把频次减半后重建
+void buildLengths(const uint32_t* freq, int n, int maxBits, uint8_t* lengths) {
+    std::memset(lengths, 0, n);
+    std::vector<uint32_t> f(freq, freq + n);
+    std::vector<int> used;
+    for (int s = 0; s < n; ++s) if (f[s]) used.push_back(s);
+    if (used.empty()) {
+        lengths[0] = lengths[1] = 1;
+        return;
+    }
+    if (used.size() == 1) {
+        // 单个符号：补一个伙伴，保证码表完整
+        lengths[used[0]] = 1;
+        lengths[used[0] == 0 ? 1 : 0] = 1;
+        return;
+    }
+    struct Node { uint64_t weight; int left, right; };
+    for (;;) {
+        std::vector<Node> nodes;
+        std::vector<int> heap;
+        auto cmp = [&](int a, int b) { return nodes[a].weight > nodes[b].weight; };
+        for (int s : used) {
+            nodes.push_back({ f[s], -1, s });
+            heap.push_back(static_cast<int>(nodes.size()) - 1);
+        }
+        std::make_heap(heap.begin(), heap.end(), cmp);
+        while (heap.size() > 1) {
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            int a = heap.back(); heap.pop_back();
+            std::pop_heap(heap.begin(), heap.end(), cmp);
+            int b = heap.back(); heap.pop_back();
+            nodes.push_back({ nodes[a].weight + nodes[b].weight, a, b });
+            heap.push_back(static_cast<int>(nodes.size()) - 1);
+            std::push_heap(heap.begin(), heap.end(), cmp);
+        }
+        // 叶子：left = -1，right = 符号
+        int maxDepth = 0;
+        std::vector<std::pair<int, int>> stack{ { heap[0], 0 } };
+        while (!stack.empty()) {
+            auto [node, depth] = stack.back();
+            stack.pop_back();
+            if (nodes[node].left < 0) {
+                lengths[nodes[node].right] = static_cast<uint8_t>(depth);
+                maxDepth = std::max(maxDepth, depth);
+            }
+            else {
+                stack.push_back({ nodes[node].left, depth + 1 });
+                stack.push_back({ nodes[node].right, depth + 1 });
+            }
+        }
+        if (maxDepth <= maxBits) return;
+        for (int s : used) f[s] = (f[s] + 1) / 2;
+    }
+}
+
+// 码长 -> 位反转后的规范编码
+void buildCodes(const uint8_t* lengths, int n, uint16_t* codes) {
+    int count[kMaxBits + 1] = {};
+    for (int s = 0; s < n; ++s) count[lengths[s]]++;
+    count[0] = 0;
+    uint32_t nextCode[kMaxBits + 1] = {};
+    for (int len = 1, code = 0; len <= kMaxBits; ++len) {
+        code = (code + count[len - 1]) << 1;
+        nextCode[len] = code;
+    }
+    for (int s = 0; s < n; ++s) {
+        codes[s] = lengths[s] ? static_cast<uint16_t>(reverseBits(nextCode[lengths[s]]++, lengths[s])) : 0;
+    }
+}
+
+// 记号编码：字面量直接存字节值；匹配为 0x80000000 | (长度 << 16) | 距离
+constexpr uint32_t kMatchFlag = 0x80000000u;
+constexpr int kMaxMatchLen = 258;
+
+// 长度 / 距离 -> 符号的查表（距离 > 256 时按 (dist - 1) >> 7 查第二张表，同 zlib 的做法）
+struct SymbolTables {
+    uint8_t length[kMaxMatchLen + 1];
+    uint8_t distLow[256];
+    uint8_t distHigh[256];
+};
+
+const SymbolTables& symbolTables() {
+    static const SymbolTables t = [] {
+        SymbolTables st{};
+        for (int len = 3, sym = 0; len <= kMaxMatchLen; ++len) {
+            while (sym < 28 && kLengthBase[sym + 1] <= len) ++sym;
+            st.length[len] = static_cast<uint8_t>(sym);
+        }
+        for (int d = 1, sym = 0; d <= 32768; ++d) {
+            while (sym < 29 && kDistBase[sym + 1] <= d) ++sym;
+            if (d <= 256) st.distLow[d - 1] = static_cast<uint8_t>(sym);
+            else st.distHigh[(d - 1) >> 7] = static_cast<uint8_t>(sym);
+        }
+        return st;
+        }();
+    return t;
+}
+
+inline int lengthSymbol(int len) { return symbolTables().length[len]; }
+
+inline int distSymbol(int dist) {
+    const SymbolTables& t = symbolTables();
+    return dist <= 256 ? t.distLow[dist - 1] : t.distHigh[(dist - 1) >> 7];
+}
+
+// 用动态哈夫曼写出一个块
+void writeDynamicBlock(BitWriter& bw, const uint32_t* tokens, size_t count, bool last) {
+    uint32_t litFreq[286] = {}, distFreq[30] = {};
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t t = tokens[i];
+        if (t & kMatchFlag) {
+            litFreq[257 + lengthSymbol((t >> 16) & 0x1FF)]++;
+            distFreq[distSymbol(t & 0xFFFF)]++;
+        }
+        else {
+            litFreq[t]++;
+        }
+    }
+    litFreq[256] = 1;
+
+    uint8_t litLen[286], distLen[30];
+    buildLengths(litFreq, 286, kMaxBits, litLen);
+    buildLengths(distFreq, 30, kMaxBits, distLen);
+    int nlit = 286, ndist = 30;
+    while (nlit > 257 && litLen[nlit - 1] == 0) --nlit;
+    while (ndist > 1 && distLen[ndist - 1] == 0) --ndist;
+
+    // 码长序列游程编码（16 = 重复前值，17/18 = 连续零）
+    uint8_t all[286 + 30];
+    std::memcpy(all, litLen, nlit);
+    std::memcpy(all + nlit, distLen, ndist);
+    int total = nlit + ndist;
+    std::vector<std::pair<uint8_t, uint8_t>> rle; // (符号, 附加值)
+    uint32_t clFreq[19] = {};
+    for (int i = 0; i < total;) {
+        uint8_t v = all[i];
+        int run = 1;
+        while (i + run < total && all[i + run] == v) ++run;
+        if (v == 0 && run >= 3) {
+            int r = std::min(run, 138);
+            if (r >= 11) rle.push_back({ 18, uint8_t(r - 11) });
+            else rle.push_back({ 17, uint8_t(r - 3) });
+            i += r;
+        }
+        else if (v != 0 && run >= 4) {
+            rle.push_back({ v, 0 });
+            int r = std::min(run - 1, 6);
+            rle.push_back({ 16, uint8_t(r - 3) });
+            i += 1 + r;
+        }
+        else {
+            rle.push_back({ v, 0 });
+            ++i;
+        }
+    }
+    for (auto& e : rle) clFreq[e.first]++;
+    uint8_t clLen[19];
+    buildLengths(clFreq, 19, 7, clLen);
+    int nclen = 19;
+    while (nclen > 4 && clLen[kCodeLengthOrder[nclen - 1]] == 0) --nclen;
+
+    uint16_t litCode[286], distCode[30], clCode[19];
+    buildCodes(litLen, 286, litCode);
+    buildCodes(distLen, 30, distCode);
+    buildCodes(clLen, 19, clCode);
+
+    bw.put(last ? 1 : 0, 1);
+    bw.put(2, 2);
+    bw.put(nlit - 257, 5);
+    bw.put(ndist - 1, 5);
+    bw.put(nclen - 4, 4);
+    for (int i = 0; i < nclen; ++i) bw.put(clLen[kCodeLengthOrder[i]], 3);
+    for (auto& e : rle) {
+        bw.put(clCode[e.first], clLen[e.first]);
+        if (e.first == 16) bw.put(e.second, 2);
+        else if (e.first == 17) bw.put(e.second, 3);
+        else if (e.first == 18) bw.put(e.second, 7);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t t = tokens[i];
+        if (t & kMatchFlag) {
+            int len = (t >> 16) & 0x1FF, dist = t & 0xFFFF;
+            int ls = lengthSymbol(len), ds = distSymbol(dist);
+            bw.put(litCode[257 + ls], litLen[257 + ls]);
+            bw.put(len - kLengthBase[ls], kLengthExtra[ls]);
+            bw.put(distCode[ds], distLen[ds]);
+            bw.put(dist - kDistBase[ds], kDistExtra[ds]);
+        }
+        else {
+            bw.put(litCode[t], litLen[t]);
+        }
+    }
+    bw.put(litCode[256], litLen[256]);
+}
+
+// 各级别的搜索参数，取值同 zlib 的 configuration_table：
+// - goodLen : 前一匹配已达到该长度时，惰性搜索的链长缩为 1/4
+// - maxLazy : 惰性级别下，匹配达到该长度就不再尝试下一位置；非惰性级别下，超过该长度的匹配内部不再插入哈希
+// - niceLen : 找到该长度的匹配即停止搜索
+// - maxChain: 哈希链最多检查的候选数
+struct LevelParams { int goodLen, maxLazy, niceLen, maxChain; bool lazy; };
+const LevelParams kLevels[10] = {
+    { 0, 0, 0, 0, false },
+    { 4, 4, 8, 4, false }, { 4, 5, 16, 8, false }, { 4, 6, 32, 32, false },
+    { 4, 4, 16, 16, true }, { 8, 16, 32, 32, true }, { 8, 16, 128, 128, true },
+    { 8, 32, 128, 256, true }, { 32, 128, 258, 1024, true }, { 32, 258, 258, 4096, true },
+};
+
+constexpr int kWindow = 32768;
+constexpr int kHashBits = 15;
+constexpr size_t kBlockTokens = 1 << 15;
+
+// 两段数据的公共前缀长度（不超过 maxLen）：先按 8 字节整块比较，遇到不同的块再逐字节定位
+inline int matchLength(const uint8_t* a, const uint8_t* b, int maxLen) {
+    int len = 0;
+    while (len + 8 <= maxLen) {
+        uint64_t x, y;
+        std::memcpy(&x, a + len, 8);
+        std::memcpy(&y, b + len, 8);
+        if (x != y) break;
+        len += 8;
+    }
+    while (len < maxLen && a[len] == b[len]) ++len;
+    return len;
+}
+
+// LZ77（哈希链 + 可选惰性匹配），产出记号序列
+void lz77(const uint8_t* data, size_t n, const LevelParams& lp, Scratch& s) {
+    s.head.assign(size_t(1) << kHashBits, -1);
+    s.prev.resize(kWindow);
+    s.tokens.clear();
+    auto hashAt = [&](size_t i) {
+        uint32_t v = data[i] | (data[i + 1] << 8) | (data[i + 2] << 16);
+        return (v * 2654435761u) >> (32 - kHashBits);
+        };
+    auto insert = [&](size_t i) {
+        if (i + 3 > n) return;
+        uint32_t h = hashAt(i);
+        s.prev[i & (kWindow - 1)] = s.head[h];
+        s.head[h] = static_cast<int32_t>(i);
+        };
+    // 只返回比 prevLen 更长（且至少 3）的匹配，否则返回 0
+    auto find = [&](size_t i, int prevLen, int& bestDist) {
+        if (i + 3 > n) return 0;
+        int maxLen = static_cast<int>(std::min<size_t>(kMaxMatchLen, n - i));
+        int best = std::max(prevLen, 2);
+        if (maxLen <= best) return 0;
+        int nice = std::min(lp.niceLen, maxLen);
+        int chain = prevLen >= lp.goodLen ? lp.maxChain >> 2 : lp.maxChain;
+        bool found = false;
+        int32_t cand = s.head[hashAt(i)];
+        for (; cand >= 0 && chain > 0; --chain) {
+            size_t c = static_cast<size_t>(cand);
+            if (c >= i || i - c > kWindow) break;
+            // 先比对当前最佳长度处与首字节，多数候选在这里被淘汰
+            if (data[c + best] == data[i + best] && data[c] == data[i]) {
+                int len = matchLength(data + c, data + i, maxLen);
+                if (len > best) {
+                    best = len;
+                    bestDist = static_cast<int>(i - c);
+                    found = true;
+                    if (len >= nice) break;
+                }
+            }
+            int32_t next = s.prev[c & (kWindow - 1)];
+            if (next >= cand) break; // 窗口回绕后的陈旧链
+            cand = next;
+        }
+        return found ? best : 0;
+        };
+    auto emitMatch = [&](int len, int dist) { s.tokens.push_back(kMatchFlag | (uint32_t(len) << 16) | uint32_t(dist)); };
+
+    int prevLen = 0, prevDist = 0;
+    size_t i = 0;
+    while (i < n) {
+        int dist = 0;
+        int len = (prevLen == 0 || prevLen < lp.maxLazy) ? find(i, prevLen, dist) : 0;
+        insert(i);
+        if (prevLen > 0) {
+            if (len > prevLen) {
+                // 当前位置的匹配更长：前一位置降级为字面量
+                s.tokens.push_back(data[i - 1]);
+                prevLen = len;
+                prevDist = dist;
+                ++i;
+                continue;
+            }
+            emitMatch(prevLen, prevDist);
+            size_t end = i - 1 + prevLen;
+            for (size_t k = i + 1; k < end; ++k) insert(k);
+            i = end;
+            prevLen = 0;
+            continue;
+        }
+        if (len == 0) {
+            s.tokens.push_back(data[i]);
+            ++i;
+        }
+        else if (lp.lazy && len < lp.maxLazy && i + 1 < n) {
+            prevLen = len;
+            prevDist = dist;
+            ++i;
+        }
+        else {
+            emitMatch(len, dist);
+            if (lp.lazy || len <= lp.maxLazy) {
+                for (size_t k = i + 1; k < i + len; ++k) insert(k);
+            }
+            i += len;
+        }
+    }
+    if (prevLen > 0) emitMatch(prevLen, prevDist);
+}
+
+void zlibDeflate(const uint8_t* data, size_t n, int level, Scratch& s, std::vector<uint8_t>& out) {
+    level = std::clamp(level, 0, 9);
+    out.clear();
+    out.push_back(0x78);
+    out.push_back(level <= 1 ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA);
+    BitWriter bw(out);
+    if (level == 0) {
+        size_t pos = 0;
+        do {
+            size_t len = std::min<size_t>(n - pos, 65535);
+            bool last = pos + len == n;
+            bw.put(last ? 1 : 0, 1);
+            bw.put(0, 2);
+            bw.flushToByte();
+            bw.put(static_cast<uint32_t>(len), 16);
+            bw.put(static_cast<uint32_t>(len) ^ 0xFFFF, 16);
+            out.insert(out.end(), data + pos, data + pos + len);
+            pos += len;
+        } while (pos < n);
+    }
+    else {
+        lz77(data, n, kLevels[level], s);
+        size_t total = s.tokens.size();
+        size_t pos = 0;
+        do {
+            size_t count = std::min(total - pos, kBlockTokens);
+            writeDynamicBlock(bw, s.tokens.data() + pos, count, pos + count == total);
+            pos += count;
+        } while (pos < total);
+        bw.flushToByte();
+    }
+    appendBe32(out, adler32(data, n));
+}
+
+// ------------------- 扫描线过滤 --------------------------
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return static_cast<uint8_t>(a);
+    if (pb <= pc) return static_cast<uint8_t>(b);
+    return static_cast<uint8_t>(c);
+}
+
+constexpr int kBpp = 4;
+
+bool unfilterRow(int type, const uint8_t* src, uint8_t* cur, const uint8_t* prior, size_t stride) {
+    switch (type) {
+    case 0:
+        std::memcpy(cur, src, stride);
+        return true;
+    case 1:
+        for (size_t i = 0; i < stride; ++i) cur[i] = uint8_t(src[i] + (i >= kBpp ? cur[i - kBpp] : 0));
+        return true;
+    case 2:
+        for (size_t i = 0; i < stride; ++i) cur[i] = uint8_t(src[i] + (prior ? prior[i] : 0));
+        return true;
+    case 3:
+        for (size_t i = 0; i < stride; ++i) {
+            int left = i >= kBpp ? cur[i - kBpp] : 0, up = prior ? prior[i] : 0;
+            cur[i] = uint8_t(src[i] + ((left + up) >> 1));
+        }
+        return true;
+    case 4:
+        for (size_t i = 0; i < stride; ++i) {
+            int left = i >= kBpp ? cur[i - kBpp] : 0, up = prior ? prior[i] : 0;
+            int upLeft = (prior && i >= kBpp) ? prior[i - kBpp] : 0;
+            cur[i] = uint8_t(src[i] + paeth(left, up, upLeft));
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+// 按过滤类型分别展开成独立循环，循环体内不再分支，便于编译器向量化。
+// prior 不可为空：首行传入全零行。
+void filterRow(int type, const uint8_t* cur, const uint8_t* prior, size_t stride, uint8_t* dst) {
+    size_t head = std::min<size_t>(kBpp, stride);
+    switch (type) {
+    case 0:
+        std::memcpy(dst, cur, stride);
+        break;
+    case 1:
+        std::memcpy(dst, cur, head);
+        for (size_t i = kBpp; i < stride; ++i) dst[i] = uint8_t(cur[i] - cur[i - kBpp]);
+        break;
+    case 2:
+        for (size_t i = 0; i < stride; ++i) dst[i] = uint8_t(cur[i] - prior[i]);
+        break;
+    case 3:
+        for (size_t i = 0; i < head; ++i) dst[i] = uint8_t(cur[i] - (prior[i] >> 1));
+        for (size_t i = kBpp; i < stride; ++i) dst[i] = uint8_t(cur[i] - ((cur[i - kBpp] + prior[i]) >> 1));
+        break;
+    default:
+        for (size_t i = 0; i < head; ++i) dst[i] = uint8_t(cur[i] - prior[i]); // 左侧为 0 时 Paeth 退化为上方
+        for (size_t i = kBpp; i < stride; ++i) dst[i] = uint8_t(cur[i] - paeth(cur[i - kBpp], prior[i], prior[i - kBpp]));
+        break;
+    }
+}
+
+// 过滤后字节按有符号数取绝对值求和，用作挑选过滤类型的代价
+uint64_t filterCost(const uint8_t* row, size_t stride) {
+    uint64_t cost = 0;
+    for (size_t i = 0; i < stride; ++i) {
+        int v = static_cast<int8_t>(row[i]);
+        cost += static_cast<uint64_t>(v < 0 ? -v : v);
+    }
+    return cost;
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* body, size_t len) {
+    appendBe32(out, static_cast<uint32_t>(len));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (len) out.insert(out.end(), body, body + len);
+    appendBe32(out, crc32(out.data() + start, len + 4));
+}
+
+} // namespace
+
+bool decodeRgba8(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height,
+    std::vector<uint8_t>& pixels, Scratch& scratch) {
+    if (size < 8 || std::memcmp(data, kSignature, 8) != 0) return false;
+    bool gotHeader = false;
+    scratch.idat.clear();
+    for (size_t pos = 8; pos + 12 <= size;) {
+        uint32_t len = readBe32(data + pos);
+        if (len > size - pos - 12) return false;
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = type + 4;
+        if (crc32(type, len + 4) != readBe32(body + len)) return false;
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || gotHeader) return false;
+            width = readBe32(body);
+            height = readBe32(body + 4);
+            // 位深 8、颜色类型 6（RGBA）、标准压缩 / 过滤、非隔行
+            if (body[8] != 8 || body[9] != 6 || body[10] != 0 || body[11] != 0 || body[12] != 0) return false;
+            if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension) return false;
+            gotHeader = true;
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0) {
+            if (!gotHeader) return false;
+            scratch.idat.insert(scratch.idat.end(), body, body + len);
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        else if (!(type[0] & 0x20)) {
+            return false; // 不认识的关键块
+        }
+        pos += 12 + size_t(len);
+    }
+    if (!gotHeader || scratch.idat.empty()) return false;
+
+    size_t stride = size_t(width) * kBpp;
+    scratch.filtered.resize((stride + 1) * height);
+    if (!zlibInflate(scratch.idat.data(), scratch.idat.size(), scratch.filtered.data(), scratch.filtered.size())) return false;
+
+    pixels.resize(stride * height);
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* src = scratch.filtered.data() + y * (stride + 1);
+        uint8_t* cur = pixels.data() + y * stride;
+        if (!unfilterRow(src[0], src + 1, cur, y ? cur - stride : nullptr, stride)) return false;
+    }
+    return true;
+}
+
+bool rewritePalette(const uint8_t* data, size_t size, PaletteFn fn, std::vector<uint8_t>& out) {
+    if (size < 8 || std::memcmp(data, kSignature, 8) != 0) return false;
+    // IHDR 必为首块：颜色类型不是 3 时不必扫描整个文件
+    if (size < 33 || std::memcmp(data + 12, "IHDR", 4) != 0 || data[25] != 3) return false;
+    // 先完整校验一遍，确认块结构无误再动 out
+    bool gotHeader = false, gotPalette = false;
+    size_t end = 0;
+    for (size_t pos = 8; pos + 12 <= size;) {
+        uint32_t len = readBe32(data + pos);
+        if (len > size - pos - 12) return false;
+        const uint8_t* type = data + pos + 4;
+        const uint8_t* body = type + 4;
+        if (crc32(type, len + 4) != readBe32(body + len)) return false;
+        pos += 12 + size_t(len);
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || gotHeader || body[9] != 3) return false;
+            gotHeader = true;
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0) {
+            if (!gotHeader || gotPalette || len == 0 || len % 3 != 0 || len > 256 * 3) return false;
+            gotPalette = true;
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0) {
+            end = pos;
+            break;
+        }
+    }
+    if (!gotPalette || end == 0) return false;
+
+    out.assign(data, data + end);
+    for (size_t pos = 8; pos < end;) {
+        uint32_t len = readBe32(out.data() + pos);
+        uint8_t* type = out.data() + pos + 4;
+        if (std::memcmp(type, "PLTE", 4) == 0) {
+            fn(type + 4, len / 3);
+            uint32_t crc = crc32(type, len + 4);
+            uint8_t* p = type + 4 + len;
+            p[0] = uint8_t(crc >> 24); p[1] = uint8_t(crc >> 16); p[2] = uint8_t(crc >> 8); p[3] = uint8_t(crc);
+            break;
+        }
+        pos += 12 + size_t(len);
+    }
+    return true;
+}
+
+bool encodeRgba8(const uint8_t* pixels, uint32_t width, uint32_t height, int level,
+    std::vector<uint8_t>& out, Scratch& scratch) {
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension) return false;
+    size_t stride = size_t(width) * kBpp;
+    scratch.filtered.resize((stride + 1) * height);
+
+    std::vector<uint8_t> zeroRow(stride, 0);
+    // 过滤：级别 0 不过滤；否则逐行挑绝对值和最小的过滤方式（libpng 的经典启发式）
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t* cur = pixels + y * stride;
+        const uint8_t* prior = y ? cur - stride : zeroRow.data();
+        uint8_t* dst = scratch.filtered.data() + y * (stride + 1);
+        int bestType = 0, lastType = -1;
+        if (level > 0) {
+            uint64_t bestCost = UINT64_MAX;
+            for (int type = 0; type <= 4; ++type) {
+                filterRow(type, cur, prior, stride, dst + 1);
+                lastType = type;
+                uint64_t cost = filterCost(dst + 1, stride);
+                if (cost < bestCost) { bestCost = cost; bestType = type; }
+            }
+        }
+        dst[0] = static_cast<uint8_t>(bestType);
+        if (bestType != lastType) filterRow(bestType, cur, prior, stride, dst + 1);
+    }
+
+    zlibDeflate(scratch.filtered.data(), scratch.filtered.size(), level, scratch, scratch.idat);
+
+    uint8_t ihdr[13];
+    ihdr[0] = uint8_t(width >> 24); ihdr[1] = uint8_t(width >> 16); ihdr[2] = uint8_t(width >> 8); ihdr[3] = uint8_t(width);
+    ihdr[4] = uint8_t(height >> 24); ihdr[5] = uint8_t(height >> 16); ihdr[6] = uint8_t(height >> 8); ihdr[7] = uint8_t(height);
+    ihdr[8] = 8;   // 位深
+    ihdr[9] = 6;   // RGBA
+    ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+    out.clear();
+    out.reserve(8 + 25 + scratch.idat.size() + 12 + 12);
+    out.insert(out.end(), kSignature, kSignature + 8);
+    appendChunk(out, "IHDR", ihdr, sizeof(ihdr));
+    appendChunk(out, "IDAT", scratch.idat.data(), scratch.idat.size());
+    appendChunk(out, "IEND", nullptr, 0);
+    return true;
+}
+
+} // namespace minipng
@@ -0,0 +1,46 @@
+/*
+========================================
+【minipng - ICO 内嵌 PNG 的轻量编解码】
+========================================
+
+只处理 ICO 内嵌图像的标准形态：8 位 RGBA、非隔行扫描的 PNG；调色板 PNG 另有只改写 PLTE 的快捷路径。
+自带 inflate / deflate（含动态哈夫曼），不依赖 zlib 与 OpenCV；
+所有中间数据放在调用方持有的 Scratch 里，多次调用之间复用容量，避免反复分配。
+遇到其他颜色类型、位深、隔行或损坏数据时返回 false，由调用方退回通用解码器。
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace minipng {
+
+// 复用的工作缓冲
+struct Scratch {
+    std::vector<uint8_t> idat;      // 解码：拼接后的 IDAT；编码：输出的 zlib 流
+    std::vector<uint8_t> filtered;  // 带过滤类型字节的扫描线
+    std::vector<int32_t> head;      // LZ77 哈希表
+    std::vector<int32_t> prev;      // LZ77 哈希链
+    std::vector<uint32_t> tokens;   // LZ77 输出的字面量 / 匹配
+};
+
+// 压缩级别：0 = 仅存储；1..9 = 压缩率递增、速度递减
+constexpr int kDefaultLevel = 6;
+
+// 解码 8 位 RGBA 非隔行 PNG，像素按 R、G、B、A 顺序紧密排列写入 pixels
+bool decodeRgba8(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height,
+    std::vector<uint8_t>& pixels, Scratch& scratch);
+
+// 把 R、G、B、A 顺序的像素编码为 PNG（IHDR + 单个 IDAT + IEND），写入 out
+bool encodeRgba8(const uint8_t* pixels, uint32_t width, uint32_t height, int level,
+    std::vector<uint8_t>& out, Scratch& scratch);
+
+// 调色板 PNG（颜色类型 3）：PLTE 的各项按 R、G、B 紧密排列交给 fn 就地改写，重算 PLTE 的 CRC，
+// 其余块（IDAT、tRNS 等）逐字节原样拷贝到 out，不解压像素。
+// 不是调色板 PNG 或块结构 / CRC 有误时返回 false
+using PaletteFn = void (*)(uint8_t* rgb, size_t entries);
+bool rewritePalette(const uint8_t* data, size_t size, PaletteFn fn, std::vector<uint8_t>& out);
+
+} // namespace minipng